@@ -0,0 +1,268 @@
+/**
+ * Benchmarks for the GeographicLib C API shim
+ *
+ * Times the shim's scalar calls over realistic inputs: short segments between
+ * adjacent points of the GPX tracks used by the integration tests, and the
+ * generally much longer segments in testdata/intercepts.csv.  Each benchmark
+ * runs single-threaded and then across all hardware threads, reporting
+ * nanoseconds per call and calls per second.
+ *
+ * Usage: shim_bench [--min-time SECONDS] [--threads N] [FILE.gpx|FILE.csv ...]
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "shim.h"
+
+namespace {
+
+struct Point {
+  double lat;
+  double lon;
+};
+
+struct Segment {
+  Point start;
+  Point end;
+};
+
+/** Inputs shared by all benchmarks in a group */
+struct Inputs {
+  std::string name;
+  std::vector<Segment> segments;
+};
+
+bool ends_with(const std::string& s, const std::string& suffix) {
+  return s.size() >= suffix.size() &&
+         s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+/**
+ * Reads the lat and lon attributes of track and route points from a GPX file
+ *
+ * This is a plain text scan rather than an XML parse, which is enough for the
+ * test data.
+ */
+std::vector<Point> read_gpx_points(const std::string& path) {
+  std::ifstream in(path);
+  std::stringstream buf;
+  buf << in.rdbuf();
+  const std::string xml = buf.str();
+
+  auto attribute = [&](size_t tag_start, size_t tag_end, const char* name,
+                       double& value) {
+    const std::string key = std::string(" ") + name + "=\"";
+    size_t pos = xml.find(key, tag_start);
+    if (pos == std::string::npos || pos > tag_end) {
+      return false;
+    }
+    value = std::strtod(xml.c_str() + pos + key.size(), nullptr);
+    return true;
+  };
+
+  std::vector<Point> points;
+  for (const char* tag : {"<trkpt", "<rtept"}) {
+    for (size_t pos = xml.find(tag); pos != std::string::npos;
+         pos = xml.find(tag, pos + 1)) {
+      size_t end = xml.find('>', pos);
+      Point p;
+      if (end != std::string::npos && attribute(pos, end, "lat", p.lat) &&
+          attribute(pos, end, "lon", p.lon)) {
+        points.push_back(p);
+      }
+    }
+  }
+  return points;
+}
+
+/** Reads the segments from an intercepts CSV file, as in testdata */
+std::vector<Segment> read_intercept_segments(const std::string& path) {
+  std::ifstream in(path);
+  std::vector<Segment> segments;
+  std::string line;
+  while (std::getline(in, line)) {
+    std::vector<double> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ',')) {
+      fields.push_back(std::strtod(field.c_str(), nullptr));
+    }
+    if (fields.size() >= 4) {
+      segments.push_back({{fields[0], fields[1]}, {fields[2], fields[3]}});
+    }
+  }
+  return segments;
+}
+
+/** Accumulates results so that the calls being timed can't be elided */
+std::atomic<double> sink{0.0};
+
+using Body = std::function<double(const Segment&)>;
+
+/**
+ * Runs `body` over the segments repeatedly for at least `min_time` on each of
+ * `threads` threads, returning the mean wall-clock time per call
+ */
+double time_per_call(const std::vector<Segment>& segments, const Body& body,
+                     double min_time, unsigned threads) {
+  using clock = std::chrono::steady_clock;
+  std::vector<size_t> calls(threads, 0);
+  std::atomic<bool> go{false};
+
+  auto worker = [&](unsigned t) {
+    while (!go) {
+    }
+    double acc = 0.0;
+    size_t n = 0;
+    const auto deadline =
+        clock::now() + std::chrono::duration<double>(min_time);
+    do {
+      for (size_t i = t; i < segments.size() + t; ++i) {
+        acc += body(segments[i % segments.size()]);
+      }
+      n += segments.size();
+    } while (clock::now() < deadline);
+    calls[t] = n;
+    sink = sink + acc;
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; ++t) {
+    pool.emplace_back(worker, t);
+  }
+  const auto start = clock::now();
+  go = true;
+  for (auto& thread : pool) {
+    thread.join();
+  }
+  const double elapsed =
+      std::chrono::duration<double>(clock::now() - start).count();
+
+  size_t total = 0;
+  for (size_t n : calls) {
+    total += n;
+  }
+  return elapsed * 1e9 / static_cast<double>(total);
+}
+
+struct Benchmark {
+  const char* name;
+  Body body;
+};
+
+std::vector<Benchmark> benchmarks() {
+  return {
+      {"geodesic_inverse_with_azimuth",
+       [](const Segment& s) {
+         double s12, azi1, azi2, a12;
+         geodesic_inverse_with_azimuth(s.start.lat, s.start.lon, s.end.lat,
+                                       s.end.lon, &s12, &azi1, &azi2, &a12);
+         return s12;
+       }},
+      {"geodesic_direct",
+       [](const Segment& s) {
+         double lat2, lon2, a12;
+         geodesic_direct(s.start.lat, s.start.lon, 45.0, 1000.0, &lat2, &lon2,
+                         &a12);
+         return lat2;
+       }},
+      {"gnomonic_forward",
+       [](const Segment& s) {
+         double x, y;
+         gnomonic_forward(s.start.lat, s.start.lon, s.end.lat, s.end.lon, &x,
+                          &y);
+         return x;
+       }},
+      {"gnomonic_reverse",
+       [](const Segment& s) {
+         double lat, lon;
+         gnomonic_reverse(s.start.lat, s.start.lon, 100.0, -250.0, &lat, &lon);
+         return lat;
+       }},
+      {"geocentric_forward",
+       [](const Segment& s) {
+         double x, y, z;
+         geocentric_forward(s.start.lat, s.start.lon, 0.0, &x, &y, &z);
+         return x;
+       }},
+  };
+}
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: shim_bench [--min-time SECONDS] [--threads N] "
+               "[FILE.gpx|FILE.csv ...]\n");
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  double min_time = 0.5;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::string> paths;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--min-time" && i + 1 < argc) {
+      min_time = std::atof(argv[++i]);
+    } else if (arg == "--threads" && i + 1 < argc) {
+      threads = std::max(1, std::atoi(argv[++i]));
+    } else if (arg.rfind("--", 0) == 0) {
+      usage();
+      return 2;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+
+  Inputs short_segments{"short (GPX tracks)", {}};
+  Inputs long_segments{"long (intercepts.csv)", {}};
+  for (const auto& path : paths) {
+    if (ends_with(path, ".gpx")) {
+      auto points = read_gpx_points(path);
+      for (size_t i = 0; i + 1 < points.size(); ++i) {
+        short_segments.segments.push_back({points[i], points[i + 1]});
+      }
+    } else if (ends_with(path, ".csv")) {
+      auto segments = read_intercept_segments(path);
+      long_segments.segments.insert(long_segments.segments.end(),
+                                    segments.begin(), segments.end());
+    } else {
+      std::fprintf(stderr, "unrecognized input file: %s\n", path.c_str());
+      return 2;
+    }
+  }
+
+  std::printf("%s, %s, %s kernels\n", geographiclib_version(),
+              compiler_version(), shim_cpu_features());
+  for (const Inputs* inputs : {&short_segments, &long_segments}) {
+    if (inputs->segments.empty()) {
+      continue;
+    }
+    std::printf("\n%s: %zu segments\n", inputs->name.c_str(),
+                inputs->segments.size());
+    std::printf("%-30s %8s %12s %14s\n", "benchmark", "threads", "ns/call",
+                "calls/s");
+    for (const auto& benchmark : benchmarks()) {
+      for (unsigned t : {1u, threads}) {
+        double ns = time_per_call(inputs->segments, benchmark.body, min_time, t);
+        std::printf("%-30s %8u %12.1f %14.0f\n", benchmark.name, t, ns,
+                    1e9 / ns);
+        if (threads == 1) {
+          break;
+        }
+      }
+    }
+  }
+  return 0;
+}
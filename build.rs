@@ -66,6 +66,84 @@ mod sources {
     }
 }
 
+/// Applies the opt-in tuning of the native geocxx build
+///
+/// - `GEOCXX_TARGET_CPU` compiles for a CPU, as with `-march`, e.g. `native` or
+///   `x86-64-v3`.
+/// - `GEOCXX_PGO_GENERATE` instruments the library to write profiles to the
+///   given directory, and `GEOCXX_PGO_USE` optimizes it with the profiles at
+///   the given path.  See `scripts/pgo_build.sh`.
+/// - The `cxx-lto` feature compiles the library to LLVM bitcode, so that it can
+///   be optimized along with the Rust code at link time.
+///
+/// Release artifacts are built with none of these, so they run on any CPU of
+/// their target and are reproducible from the source alone.
+fn configure_tuning(build: &mut cc::Build) {
+    const VARS: [&str; 3] = ["GEOCXX_TARGET_CPU", "GEOCXX_PGO_GENERATE", "GEOCXX_PGO_USE"];
+    for var in VARS {
+        println!("cargo:rerun-if-env-changed={var}");
+    }
+
+    let compiler = build.get_compiler();
+    if compiler.is_like_msvc() {
+        for var in VARS {
+            if std::env::var_os(var).is_some() {
+                println!("cargo:warning={var} is not supported with MSVC and was ignored");
+            }
+        }
+        if cfg!(feature = "cxx-lto") {
+            panic!("The cxx-lto feature requires Clang as the C++ compiler");
+        }
+        return;
+    }
+
+    if let Ok(cpu) = std::env::var("GEOCXX_TARGET_CPU") {
+        build.flag(format!("-march={cpu}"));
+    }
+
+    if let Ok(dir) = std::env::var("GEOCXX_PGO_GENERATE") {
+        build.flag(format!("-fprofile-generate={dir}"));
+        // The linker driver only adds the compiler's profiling runtime when
+        // it's given the flag too, so it needs to be the same compiler.
+        println!("cargo:rustc-link-arg=-fprofile-generate");
+    }
+
+    if let Ok(path) = std::env::var("GEOCXX_PGO_USE") {
+        build.flag(format!("-fprofile-use={path}"));
+        // Code the training run didn't reach is still optimized for speed,
+        // rather than for size as GCC would otherwise treat it.
+        if compiler.is_like_gnu() {
+            build.flag("-fprofile-partial-training");
+        }
+        build.flag_if_supported("-Wno-missing-profile");
+        println!("cargo:rerun-if-changed={path}");
+    }
+
+    if cfg!(feature = "cxx-lto") {
+        if !compiler.is_like_clang() {
+            panic!("The cxx-lto feature requires Clang as the C++ compiler, e.g. CXX=clang++");
+        }
+        // Without linker plugin LTO, rustc would link the bitcode objects
+        // as if they were native code.
+        let rustflags = std::env::var("CARGO_ENCODED_RUSTFLAGS").unwrap_or_default();
+        if !rustflags
+            .split('\x1f')
+            .any(|f| f.contains("linker-plugin-lto"))
+        {
+            panic!(concat!(
+                "The cxx-lto feature requires RUSTFLAGS to include -Clinker-plugin-lto, ",
+                "along with a Clang linker using lld. See docs/development.md."
+            ));
+        }
+        build.flag("-flto=thin");
+        // GNU ar can't index bitcode objects, leaving an archive lld can't
+        // search.
+        if std::env::var_os("AR").is_none() {
+            build.archiver("llvm-ar");
+        }
+    }
+}
+
 fn main() {
     if !std::fs::exists(GEOGRAPHICLIB_SRC).unwrap() {
         panic!(concat!(
@@ -82,15 +160,26 @@ fn main() {
     if target != "wasm32-unknown-unknown" {
         // Thankfully GeographicLib has a pretty simple build, so we can just compile
         // all the source files here rather than go through CMake.
-        cc::Build::new()
+        let mut build = cc::Build::new();
+        build
             .cpp(true)
             .flag_if_supported("-std=c++17")
             .flag_if_supported("/std:c++17")
+            // Lets sqrt be vectorized in the shim's batch kernels, and comparisons
+            // be turned into selects.  Neither errno nor floating point exceptions
+            // are inspected by the shim or GeographicLib.
+            .flag_if_supported("-fno-math-errno")
+            .flag_if_supported("-fno-trapping-math")
+            // Keeps multiplies and adds from being fused on CPUs with FMA, so that
+            // the shim's dispatched kernels and GEOCXX_TARGET_CPU builds round the
+            // same way as the baseline.
+            .flag_if_supported("-ffp-contract=off")
             .file("src/shim.cpp")
             .files(sources::geographiclib_cpp().unwrap())
             .flag("-I./include")
-            .flag("-I./geographiclib/include")
-            .compile("geocxx");
+            .flag("-I./geographiclib/include");
+        configure_tuning(&mut build);
+        build.compile("geocxx");
 
         for file in sources::geographiclib_cpp().unwrap() {
             println!("cargo:rerun-if-changed={}", file.display());
@@ -0,0 +1,122 @@
+use std::fs::{self, File};
+use std::io::BufReader;
+use std::path::PathBuf;
+use std::time::Instant;
+
+use anyhow::{Result, bail};
+use clap::Parser;
+use coursepointer::course::{CourseSetOptions, GeodesicSolver};
+use coursepointer::internal::{
+    PIPELINE_SCALES, PipelineRun, PipelineScale, resample_track, run_pipeline, synthetic_track,
+    synthetic_waypoints,
+};
+use coursepointer::{GeoPoint, segment_gpx};
+
+/// Times the whole course building pipeline on scaled inputs
+///
+/// Resamples a base track to each scale's number of points, scatters its
+/// number of waypoints along it, and builds a course set from them, reporting
+/// points and waypoints per second and the process's peak resident set size.
+/// Run it against two builds to compare them end to end.
+#[derive(Parser)]
+struct Cli {
+    /// GPX file whose first track or route is the base track
+    #[clap(long, conflicts_with = "synthetic")]
+    gpx: Option<PathBuf>,
+
+    /// Use the same synthetic base track as the wasm benchmark
+    #[clap(long)]
+    synthetic: bool,
+
+    /// Largest number of track points to run, from the default scales
+    #[clap(long, default_value_t = 10_000_000)]
+    max_points: usize,
+
+    /// Run a single scale with this many track points instead
+    #[clap(long, requires = "waypoints")]
+    points: Option<usize>,
+
+    /// Number of waypoints for --points
+    #[clap(long, requires = "points")]
+    waypoints: Option<usize>,
+
+    /// Also report what the shim's probes recorded during each build
+    #[clap(long)]
+    probes: bool,
+}
+
+fn read_base_track(cli: &Cli) -> Result<Vec<GeoPoint>> {
+    let Some(path) = &cli.gpx else {
+        return Ok(synthetic_track(3_590)?);
+    };
+    let mut points = Vec::new();
+    segment_gpx(
+        BufReader::new(File::open(path)?),
+        GeodesicSolver::default(),
+        |record| points.push(record.point),
+    )?;
+    if points.len() < 2 {
+        bail!("{} has fewer than two track points", path.display());
+    }
+    Ok(points)
+}
+
+/// Restarts the kernel's count of the process's peak resident set size
+///
+/// Peak RSS is otherwise a high-water mark for the whole process, which each
+/// scale would inherit from the one before.  Only works on Linux.
+fn reset_peak_rss() {
+    let _ = fs::write("/proc/self/clear_refs", "5");
+}
+
+/// The process's peak resident set size in MiB, on Linux
+fn peak_rss_mib() -> Option<f64> {
+    let status = fs::read_to_string("/proc/self/status").ok()?;
+    let kib = status
+        .lines()
+        .find_map(|line| line.strip_prefix("VmHWM:"))?
+        .trim()
+        .strip_suffix("kB")?
+        .trim()
+        .parse::<f64>()
+        .ok()?;
+    Some(kib / 1024.0)
+}
+
+fn main() -> Result<()> {
+    let cli = Cli::parse();
+    if cli.gpx.is_none() && !cli.synthetic {
+        bail!("Specify a base track with --gpx, or --synthetic");
+    }
+    let scales = match (cli.points, cli.waypoints) {
+        (Some(points), Some(waypoints)) => vec![PipelineScale { points, waypoints }],
+        _ => PIPELINE_SCALES
+            .iter()
+            .copied()
+            .filter(|scale| scale.points <= cli.max_points)
+            .collect(),
+    };
+
+    let base = read_base_track(&cli)?;
+    println!("Base track of {} points", base.len());
+    println!("{}  {:>8}", PipelineRun::header(), "peak MiB");
+
+    let epoch = Instant::now();
+    for scale in scales {
+        reset_peak_rss();
+        let track = resample_track(&base, scale.points.max(2))?;
+        let waypoints = synthetic_waypoints(&track, scale.waypoints)?;
+        let run = run_pipeline(
+            &track,
+            &waypoints,
+            CourseSetOptions::default(),
+            cli.probes,
+            || epoch.elapsed().as_secs_f64(),
+        )?;
+        println!("{}  {:>8.1}", run.row(), peak_rss_mib().unwrap_or(f64::NAN));
+        if cli.probes {
+            print!("{}", run.probe_breakdown());
+        }
+    }
+    Ok(())
+}
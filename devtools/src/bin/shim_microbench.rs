@@ -0,0 +1,134 @@
+use std::hint::black_box;
+use std::time::Instant;
+
+use anyhow::{Result, bail};
+use clap::Parser;
+use coursepointer::internal::{compiler_version_str, geographiclib_version_str};
+
+/// Measures the per-call cost of the GeographicLib shim
+///
+/// Times many calls to each of the scalar geodesic functions on a fixed set of
+/// pseudo-random nearby points, as in a typical course, and reports the mean
+/// time per call.  The shim's C functions are called directly, since their
+/// signatures haven't changed, so the benchmark can be copied into an older
+/// tree to compare per-call overhead across builds.
+#[derive(Parser)]
+struct Cli {
+    /// Number of calls to time per function
+    #[clap(long, default_value_t = 1_000_000)]
+    calls: usize,
+
+    /// Number of distinct points to cycle through
+    #[clap(long, default_value_t = 1024)]
+    points: usize,
+}
+
+// These link against the same geocxx library as the coursepointer crate.
+unsafe extern "C" {
+    fn geodesic_direct(
+        lat1: f64,
+        lon1: f64,
+        az1: f64,
+        s12: f64,
+        lat2: &mut f64,
+        lon2: &mut f64,
+        a12: &mut f64,
+    ) -> bool;
+
+    fn geodesic_inverse_with_azimuth(
+        lat1: f64,
+        lon1: f64,
+        lat2: f64,
+        lon2: f64,
+        s12: &mut f64,
+        azi1: &mut f64,
+        azi2: &mut f64,
+        a12: &mut f64,
+    ) -> bool;
+
+    fn gnomonic_forward(lat0: f64, lon0: f64, lat: f64, lon: f64, x: &mut f64, y: &mut f64)
+    -> bool;
+
+    fn geocentric_forward(
+        lat: f64,
+        lon: f64,
+        h: f64,
+        x: &mut f64,
+        y: &mut f64,
+        z: &mut f64,
+    ) -> bool;
+}
+
+/// A small, deterministic generator so runs are comparable
+struct Lcg(u64);
+
+impl Lcg {
+    fn next_unit(&mut self) -> f64 {
+        self.0 = self
+            .0
+            .wrapping_mul(6364136223846793005)
+            .wrapping_add(1442695040888963407);
+        (self.0 >> 11) as f64 / (1u64 << 53) as f64
+    }
+}
+
+/// Times `calls` calls of `f`, which returns whether its call succeeded
+fn time_calls<F: FnMut(usize) -> bool>(name: &str, calls: usize, mut f: F) -> Result<()> {
+    let start = Instant::now();
+    for i in 0..calls {
+        if !f(i) {
+            bail!("{name} failed on call {i}");
+        }
+    }
+    let elapsed = start.elapsed();
+    println!(
+        "{:<20} {:>10.1} ns/call",
+        name,
+        elapsed.as_nanos() as f64 / calls as f64
+    );
+    Ok(())
+}
+
+fn main() -> Result<()> {
+    let cli = Cli::parse();
+    let mut rng = Lcg(0x5eed);
+    let points = (0..cli.points.max(2))
+        .map(|_| (37.0 + rng.next_unit(), -122.5 + rng.next_unit()))
+        .collect::<Vec<_>>();
+    let n = points.len();
+    println!(
+        "GeographicLib {}, {}",
+        geographiclib_version_str(),
+        compiler_version_str()
+    );
+
+    let mut out = [0.0; 4];
+    time_calls("geodesic_inverse", cli.calls, |i| {
+        let ((lat1, lon1), (lat2, lon2)) = (points[i % n], points[(i + 1) % n]);
+        let [s12, azi1, azi2, a12] = &mut out;
+        // SAFETY: The outputs are valid for writes.
+        black_box(unsafe {
+            geodesic_inverse_with_azimuth(lat1, lon1, lat2, lon2, s12, azi1, azi2, a12)
+        })
+    })?;
+    time_calls("geodesic_direct", cli.calls, |i| {
+        let (lat1, lon1) = points[i % n];
+        let [lat2, lon2, a12, _] = &mut out;
+        // SAFETY: The outputs are valid for writes.
+        black_box(unsafe { geodesic_direct(lat1, lon1, (i % 360) as f64, 1000.0, lat2, lon2, a12) })
+    })?;
+    time_calls("gnomonic_forward", cli.calls, |i| {
+        let ((lat0, lon0), (lat, lon)) = (points[i % n], points[(i + 1) % n]);
+        let [x, y, _, _] = &mut out;
+        // SAFETY: The outputs are valid for writes.
+        black_box(unsafe { gnomonic_forward(lat0, lon0, lat, lon, x, y) })
+    })?;
+    time_calls("geocentric_forward", cli.calls, |i| {
+        let (lat, lon) = points[i % n];
+        let [x, y, z, _] = &mut out;
+        // SAFETY: The outputs are valid for writes.
+        black_box(unsafe { geocentric_forward(lat, lon, 0.0, x, y, z) })
+    })?;
+    black_box(out);
+    Ok(())
+}
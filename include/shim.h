@@ -8,6 +8,517 @@
 #define EXTERN extern "C"
 #endif  // defined __EMSCRIPTEN__
 
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * An ellipsoid and its geodesic, gnomonic, and geocentric solvers
+ *
+ * Opaque handle passed to each of the `geo_context_*` solvers.  A context is
+ * immutable once created, so the same context may be used by any number of
+ * threads concurrently, and solvers keep no other state between calls.
+ *
+ * The functions without a context argument use the shared WGS84 context
+ * returned by `geo_context_wgs84`, and are likewise safe to call from any
+ * thread.
+ */
+struct geo_context;
+
+/**
+ * Creates a context for the ellipsoid with equatorial radius `a` meters and
+ * flattening `f`
+ *
+ * Returns null if the parameters are invalid.  Owned by the caller, who must
+ * release it with `geo_context_destroy` once no other thread is using it.
+ */
+EXTERN geo_context* geo_context_create(double a, double f) noexcept;
+
+EXTERN void geo_context_destroy(geo_context* ctx) noexcept;
+
+/**
+ * Gets the shared WGS84 context
+ *
+ * The context returned has static lifetime and must not be destroyed.
+ */
+EXTERN const geo_context* geo_context_wgs84() noexcept;
+
+/**
+ * Context-taking equivalents of the WGS84 functions declared below
+ *
+ * Each `geo_context_*` function behaves like the function of the same
+ * suffix (`geo_context_inverse` like `geodesic_inverse_with_azimuth`), but on
+ * the ellipsoid of `ctx`.
+ */
+EXTERN bool geo_context_inverse(const geo_context* ctx, double lat1,
+                                double lon1, double lat2, double lon2,
+                                double* s12, double* azi1, double* azi2,
+                                double* a12) noexcept;
+
+EXTERN bool geo_context_direct(const geo_context* ctx, double lat1,
+                               double lon1, double azi1, double s12,
+                               double* lat2, double* lon2,
+                               double* a12) noexcept;
+
+EXTERN size_t geo_context_polyline_inverse(const geo_context* ctx,
+                                           const double* latlon, size_t n,
+                                           double* s12, double* azi1,
+                                           double* azi2, double* a12,
+                                           double* cumulative,
+                                           bool* ok) noexcept;
+
+EXTERN bool geo_context_gnomonic_forward(const geo_context* ctx, double lat0,
+                                         double lon0, double lat, double lon,
+                                         double* x, double* y) noexcept;
+
+EXTERN bool geo_context_gnomonic_reverse(const geo_context* ctx, double lat0,
+                                         double lon0, double x, double y,
+                                         double* lat, double* lon) noexcept;
+
+EXTERN bool geo_context_intercept(const geo_context* ctx, double lat1,
+                                  double lon1, double lat2, double lon2,
+                                  double azi1, double s12, double latp,
+                                  double lonp, double tolerance,
+                                  unsigned max_iterations, double* lati,
+                                  double* loni, double* spi, double* s1i,
+                                  unsigned* iterations) noexcept;
+
+/**
+ * A policy for choosing how to solve the inverse geodesic problem
+ *
+ * - `GEODESIC_SERIES` uses GeographicLib's `Geodesic`, whose series
+ *   expansions are accurate to within nanometers on the Earth's ellipsoid.
+ * - `GEODESIC_EXACT` uses `GeodesicExact`, which evaluates elliptic integrals
+ *   instead, at several times the cost, and stays accurate for flattenings
+ *   far larger than the Earth's.  Builds defining `SHIM_NO_EXACT` leave it
+ *   out, and solve with `Geodesic` instead, reporting `GEODESIC_PATH_SERIES`.
+ * - `GEODESIC_AUTO` solves segments up to a kilometer long, away from the
+ *   poles, in the plane tangent to the ellipsoid at their midpoint, which
+ *   agrees with `Geodesic` to within a tenth of a millimeter at a fraction of
+ *   the cost, and falls back to `Geodesic` for everything else.
+ */
+enum geodesic_solver {
+  GEODESIC_SERIES = 0,
+  GEODESIC_EXACT = 1,
+  GEODESIC_AUTO = 2,
+};
+
+/**
+ * The solver that a `geodesic_solver` policy chose for a problem
+ */
+enum geodesic_path {
+  GEODESIC_PATH_SERIES = 0,
+  GEODESIC_PATH_EXACT = 1,
+  GEODESIC_PATH_TANGENT_PLANE = 2,
+};
+
+/**
+ * Solves the inverse problem as `geo_context_inverse` does, with the solver
+ * chosen by `solver`
+ *
+ * Reports the solver used in `path`.  Any tangent plane solution's `a12` is
+ * measured on a sphere of the midpoint's mean radius, rather than on the
+ * auxiliary sphere.
+ */
+EXTERN bool geo_context_inverse_with_solver(
+    const geo_context* ctx, geodesic_solver solver, double lat1, double lon1,
+    double lat2, double lon2, double* s12, double* azi1, double* azi2,
+    double* a12, geodesic_path* path) noexcept;
+
+/**
+ * A bounding volume hierarchy over the segments of a route
+ *
+ * Each segment's chord is boxed in geocentric coordinates, padded by the
+ * greatest depth below the ellipsoid that the chord can reach, so that any
+ * point within geodesic distance `d` of a segment lies within `d` of its box.
+ * An index is immutable once built, and may be queried from any number of
+ * threads concurrently.  Owned by the caller, who must release it with
+ * `route_index_free`.
+ */
+struct route_index;
+
+/**
+ * Builds an index over the segments joining `n_points` consecutive route
+ * points, given by their geocentric coordinates
+ *
+ * Returns null on failure, if the route has no segments, or if any coordinate
+ * isn't finite, since a segment with no box could never be found by a query.
+ */
+EXTERN route_index* geo_context_route_index_new(const geo_context* ctx,
+                                                const double* x,
+                                                const double* y,
+                                                const double* z,
+                                                size_t n_points) noexcept;
+
+EXTERN void route_index_free(route_index* index) noexcept;
+
+/**
+ * Finds the segments that might pass within `radius` meters of a point
+ *
+ * Writes the indices of up to `capacity` candidate segments to `segments`, in
+ * no particular order, and returns the total number of candidates.
+ */
+EXTERN size_t route_index_query(const route_index* index, double x, double y,
+                                double z, double radius, size_t capacity,
+                                size_t* segments) noexcept;
+
+/**
+ * Computes the maximum depth of each segment's chord beneath the ellipsoid
+ *
+ * Segment `i` runs from point `i` to point `i + 1` of the geocentric
+ * coordinates `x`, `y`, and `z`, and its depth in meters is written to
+ * `depth[i]`, which has length `n_points - 1`.
+ */
+EXTERN void geo_context_chord_depths(const geo_context* ctx, const double* x,
+                                     const double* y, const double* z,
+                                     size_t n_points, double* depth) noexcept;
+
+/**
+ * Flags the segments of a route that might pass within `threshold` meters of
+ * a point
+ *
+ * Segments are given as for `geo_context_chord_depths`, with their depths in
+ * `depth`.  Bit `i % 64` of `mask[i / 64]` is set if the lower bound on the
+ * distance from the point `(xp, yp, zp)` to segment `i` isn't greater than the
+ * threshold, and cleared otherwise.  `mask` holds `(n_points + 62) / 64`
+ * words.
+ *
+ * Returns the number of bits set.
+ */
+EXTERN size_t intercept_floor_mask(const double* x, const double* y,
+                                   const double* z, const double* depth,
+                                   size_t n_points, double xp, double yp,
+                                   double zp, double threshold,
+                                   uint64_t* mask) noexcept;
+
+/**
+ * Finds the segments of a route passing within `threshold` meters of each of
+ * a set of waypoints
+ *
+ * The route's `n_points` points are given by their latitudes and longitudes
+ * `lat` and `lon` along with their geocentric coordinates `x`, `y`, and `z`.
+ * `azi1`, `s12`, and `depth` have length `n_points - 1`, and hold the azimuth
+ * at its start, the length, and the chord depth (as computed by
+ * `geo_context_chord_depths`) of the segment from point `i` to point `i + 1`.
+ * The
+ * `n_waypoints` waypoints are given likewise by `wlat` through `wz`.
+ *
+ * If `index` is not null, it must have been built from the same route, and is
+ * used to skip segments that can't be near each waypoint.  Otherwise every
+ * segment is considered.
+ *
+ * Segments whose distance from a waypoint might be within the threshold have
+ * their intercepts solved as by `geo_context_intercept`, with `tolerance` and
+ * `max_iterations`, preparing each segment's line once for all the nearby
+ * waypoints it can.  Each intercept that is within the threshold, or that
+ * could not be solved, is a match.  Matches are ordered by waypoint and then
+ * by segment, and for `k < capacity` the k-th is written to element `k` of
+ * `waypoint`, `segment`, and the intercept outputs `lati` through `ok`.
+ *
+ * Returns the total number of matches.  If this exceeds `capacity`, the
+ * matches past it were dropped and the call should be repeated with larger
+ * arrays.
+ */
+EXTERN size_t geo_context_match_waypoints(
+    const geo_context* ctx, const route_index* index, const double* lat,
+    const double* lon, const double* x, const double* y, const double* z,
+    const double* azi1, const double* s12, const double* depth,
+    size_t n_points, const double* wlat, const double* wlon, const double* wx,
+    const double* wy, const double* wz, size_t n_waypoints, double threshold,
+    double tolerance, unsigned max_iterations, size_t capacity,
+    size_t* waypoint, size_t* segment, double* lati, double* loni, double* spi,
+    double* s1i, unsigned* iterations, bool* ok) noexcept;
+
+/**
+ * A bounded memo of geodesic solutions, shared by the routes of a course set
+ *
+ * Remembers recent solutions in a fixed number of slots for the inverse and
+ * direct problems, keyed on their exact inputs, so that segments repeated
+ * between routes (or within one, as in an out-and-back course) are only
+ * solved once.  A lookup for the reverse of a remembered
+ * inverse problem is answered from it, by swapping and reversing the
+ * azimuths.  Problems with non-finite inputs are never remembered.
+ *
+ * The cache locks its slots internally, so it may be used from any number of
+ * threads at once.  It must not outlive its context.  Owned by the caller,
+ * who must free it with `geodesic_cache_free`.
+ */
+struct geodesic_cache;
+
+/**
+ * Counts of the lookups a `geodesic_cache` has served
+ *
+ * Each lookup counts as exactly one hit, answered from a remembered solution
+ * of the same problem or of its reverse, or one miss, which was solved.
+ */
+struct geodesic_cache_stats {
+  uint64_t inverse_hits;
+  uint64_t inverse_reversed_hits;
+  uint64_t inverse_misses;
+  uint64_t direct_hits;
+  uint64_t direct_misses;
+};
+
+/**
+ * Creates a cache with room for `capacity` solutions of each problem,
+ * rounded up to a power of two
+ *
+ * Returns null on failure, or if `capacity` is zero.
+ */
+EXTERN geodesic_cache* geo_context_geodesic_cache_new(const geo_context* ctx,
+                                                      size_t capacity) noexcept;
+
+EXTERN void geodesic_cache_free(geodesic_cache* cache) noexcept;
+
+/**
+ * Solves the inverse problem as `geo_context_inverse_with_solver` does, unless
+ * the cache remembers its solution
+ */
+EXTERN bool geodesic_cache_inverse(geodesic_cache* cache,
+                                   geodesic_solver solver, double lat1,
+                                   double lon1, double lat2, double lon2,
+                                   double* s12, double* azi1, double* azi2,
+                                   double* a12, geodesic_path* path) noexcept;
+
+/**
+ * Solves the direct problem as `geo_context_direct` does, unless the cache
+ * remembers its solution
+ */
+EXTERN bool geodesic_cache_direct(geodesic_cache* cache, double lat1,
+                                  double lon1, double azi1, double s12,
+                                  double* lat2, double* lon2,
+                                  double* a12) noexcept;
+
+EXTERN void geodesic_cache_get_stats(const geodesic_cache* cache,
+                                     geodesic_cache_stats* stats) noexcept;
+
+/**
+ * A route loaded once into native memory for all of its kernels
+ *
+ * Holds the route's points and segments as parallel columns in one arena
+ * allocation, along with their segment index.  A store is loaded with
+ * `route_store_load` and then sealed with `route_store_finish`, after which
+ * it may be used from any number of threads at once, except while
+ * `route_store_move_point` edits it.  It must not outlive its context.
+ * Owned by the caller, who must free it with `route_store_free`.
+ */
+struct route_store;
+
+/**
+ * Read-only pointers to the columns of a `route_store`
+ *
+ * The point columns `lat` through `cumulative` and `point_ok` have length
+ * `n_points`, and the segment columns `azi1`, `s12`, `depth`, and
+ * `segment_ok` have length `n_points - 1` (or zero, for fewer than two
+ * points), with segment `i` joining point `i` to point `i + 1`.  The
+ * segment column `path` reports the solver each segment took.  No pointer is
+ * null, even for empty columns.  Valid for as long as the store is.
+ */
+struct route_view {
+  size_t n_points;
+  const double* lat;
+  const double* lon;
+  const double* x;
+  const double* y;
+  const double* z;
+  const double* cumulative;
+  const double* azi1;
+  const double* s12;
+  const double* depth;
+  const bool* point_ok;
+  const bool* segment_ok;
+  const geodesic_path* path;
+};
+
+/**
+ * The precision of the distance floors a `route_store` filters segments with
+ *
+ * - `PREFILTER_DOUBLE` computes them from the route's geocentric coordinates,
+ *   just as `intercept_floor_mask` does.
+ * - `PREFILTER_SINGLE` computes them from single precision copies of those
+ *   coordinates relative to a point central to the route, which halves the
+ *   memory the filter streams through and doubles the lanes of each vector
+ *   instruction.  The floors are lowered by a bound on their rounding error,
+ *   so they remain lower bounds, though looser ones for routes hundreds of
+ *   kilometers across.
+ *
+ * Either way, candidate segments are refined in double precision, so the
+ * matches found are the same.
+ */
+enum prefilter_precision {
+  PREFILTER_DOUBLE = 0,
+  PREFILTER_SINGLE = 1,
+};
+
+/**
+ * Allocates a store for a route of `n_points` points, whose segments will be
+ * solved with `solver` and filtered in `precision`
+ *
+ * If `cache` is not null, segments are solved through it while loading, so
+ * it must belong to the same context and outlive the loading of the store.
+ * Returns null on failure.  The store's contents are unspecified until every
+ * point has been loaded.
+ */
+EXTERN route_store* geo_context_route_store_new(const geo_context* ctx,
+                                                geodesic_solver solver,
+                                                prefilter_precision precision,
+                                                geodesic_cache* cache,
+                                                size_t n_points) noexcept;
+
+EXTERN void route_store_free(route_store* store) noexcept;
+
+/**
+ * Loads points `start` through `start + count - 1` of a route into a store
+ *
+ * `lat` and `lon` hold the whole route, whose points are converted to
+ * geocentric coordinates, and whose segments starting at the loaded points
+ * are solved for their azimuths and lengths.  Calls loading ranges that don't
+ * overlap may run concurrently.
+ *
+ * Returns the number of points and segments that failed, as recorded in
+ * `point_ok` and `segment_ok`.
+ */
+EXTERN size_t route_store_load(route_store* store, const double* lat,
+                               const double* lon, size_t start,
+                               size_t count) noexcept;
+
+/**
+ * Finishes a store once every point has been loaded
+ *
+ * Computes each point's cumulative distance along the route, which is NaN
+ * after any failed segment, and each segment's chord depth, and builds the
+ * segment index and any single precision coordinates.  Returns whether every
+ * point and segment was solved.
+ */
+EXTERN bool route_store_finish(route_store* store) noexcept;
+
+/** Whether a finished store's segments are indexed, rather than scanned */
+EXTERN bool route_store_indexed(const route_store* store) noexcept;
+
+EXTERN void route_store_view(const route_store* store,
+                             route_view* view) noexcept;
+
+/**
+ * Matches a set of waypoints against a finished store's route, as
+ * `geo_context_match_waypoints` does with the store's context and index
+ */
+EXTERN size_t route_store_match_waypoints(
+    const route_store* store, const double* wlat, const double* wlon,
+    const double* wx, const double* wy, const double* wz, size_t n_waypoints,
+    double threshold, double tolerance, unsigned max_iterations,
+    size_t capacity, size_t* waypoint, size_t* segment, double* lati,
+    double* loni, double* spi, double* s1i, unsigned* iterations,
+    bool* ok) noexcept;
+
+/**
+ * Moves point `i` of a finished store to `lat`, `lon`
+ *
+ * Converts the point and re-solves the segments on either side of it,
+ * without the store's cache, then refits the segment index and any single
+ * precision coordinates around the two segments, and sums the cumulative
+ * distances after them again, which takes time linear in the rest of the
+ * route.  The double precision columns and cumulative distances end up just
+ * as loading the moved route would leave them.  The single precision
+ * coordinates keep the origin loading chose and only widen their extent to
+ * cover the moved point, so they, and their prefilter's margins, can differ
+ * from a fresh load's, as can whether the store is indexed.  Index queries
+ * may slow down as points move far from where the index was built, though
+ * they stay correct; reload the route after extensive edits.  Must not be
+ * called while anything else uses the store.
+ *
+ * A point or segment that fails to convert drops the index, and the route is
+ * scanned instead.  The index is rebuilt, in O(n log n), by the first move
+ * that leaves every point and segment converted again, such as moving the
+ * point back.
+ *
+ * Returns whether the point and its segments were solved, or false without
+ * changing anything if `i` is out of range.
+ */
+EXTERN bool route_store_move_point(route_store* store, size_t i, double lat,
+                                   double lon) noexcept;
+
+/**
+ * Matches a set of waypoints against segments `first_segment` through
+ * `first_segment + n_segments - 1` of a finished store's route
+ *
+ * Finds exactly the matches `route_store_match_waypoints` would on those
+ * segments, numbering them by their place in the whole route, for
+ * re-matching just the segments an edit changed.  The range is clipped to
+ * the route, and unless it covers the whole route, is scanned without the
+ * index.
+ */
+EXTERN size_t route_store_match_segments(
+    const route_store* store, size_t first_segment, size_t n_segments,
+    const double* wlat, const double* wlon, const double* wx,
+    const double* wy, const double* wz, size_t n_waypoints, double threshold,
+    double tolerance, unsigned max_iterations, size_t capacity,
+    size_t* waypoint, size_t* segment, double* lati, double* loni, double* spi,
+    double* s1i, unsigned* iterations, bool* ok) noexcept;
+
+/**
+ * A streaming segmenter, for routes too long to load into a `route_store`
+ *
+ * Points are pushed a chunk at a time with `route_segmenter_push`, which
+ * emits a record for each point whose leaving segment is known, and the
+ * route is ended with `route_segmenter_flush`, which emits its last point.
+ * Only the trailing point is kept between chunks.  The segmenter must not
+ * outlive its context, and is not safe to use from multiple threads at once.
+ * Owned by the caller, who must free it with `route_segmenter_free`.
+ */
+struct route_segmenter;
+
+/**
+ * Creates a streaming segmenter, which solves segments with `solver`
+ *
+ * Returns null on failure.
+ */
+EXTERN route_segmenter* geo_context_route_segmenter_new(
+    const geo_context* ctx, geodesic_solver solver) noexcept;
+
+EXTERN void route_segmenter_free(route_segmenter* segmenter) noexcept;
+
+/**
+ * Pushes `n` more points of a route to a segmenter
+ *
+ * Emits records for the point left pending by the previous push, if any,
+ * followed by every new point except the last, which is kept pending until
+ * the next push or flush.  Each record holds its point's geocentric
+ * coordinates and cumulative distance along the route, and the azimuth and
+ * length of the segment joining it to the next point and the solver that
+ * took it, with the same meaning as the corresponding columns of a
+ * `route_view`.  The output arrays must each have room for `n` records.
+ *
+ * Returns the number of records emitted.
+ */
+EXTERN size_t route_segmenter_push(route_segmenter* segmenter,
+                                   const double* lat, const double* lon,
+                                   size_t n, double* x, double* y, double* z,
+                                   double* cumulative, double* azi1,
+                                   double* s12, geodesic_path* path,
+                                   bool* point_ok, bool* segment_ok) noexcept;
+
+/**
+ * Ends a segmenter's route
+ *
+ * Emits the record for the route's pending last point, which has no segment,
+ * and resets the segmenter to start a new route.  Returns the number of
+ * records emitted, which is zero if no points were pushed.
+ */
+EXTERN size_t route_segmenter_flush(route_segmenter* segmenter, double* x,
+                                    double* y, double* z, double* cumulative,
+                                    double* azi1, double* s12, bool* point_ok,
+                                    bool* segment_ok) noexcept;
+
+EXTERN bool geo_context_geocentric_forward(const geo_context* ctx, double lat,
+                                           double lon, double h, double* x,
+                                           double* y, double* z) noexcept;
+
+EXTERN size_t geo_context_geocentric_forward_batch(const geo_context* ctx,
+                                                   const double* lat,
+                                                   const double* lon, size_t n,
+                                                   double* x, double* y,
+                                                   double* z,
+                                                   bool* ok) noexcept;
+
 EXTERN bool geodesic_direct(double lat1, double lon1, double azi1, double s12,
                             double* lat2, double* lon2, double* a12) noexcept;
 
@@ -16,15 +527,135 @@ EXTERN bool geodesic_inverse_with_azimuth(double lat1, double lon1, double lat2,
                                           double* azi1, double* azi2,
                                           double* a12) noexcept;
 
+/**
+ * Solves the inverse geodesic problem between adjacent points of a polyline
+ *
+ * `latlon` holds `n` points as interleaved latitude and longitude values.
+ * `s12`, `azi1`, `azi2`, `a12`, and `ok` have length `n - 1`, and element `i`
+ * describes the segment from point `i` to point `i + 1`.  `cumulative` has
+ * length `n` and receives each point's geodesic distance along the polyline
+ * from its first point; it becomes NaN after any failed segment.
+ *
+ * Returns the number of segments solved successfully.
+ */
+EXTERN size_t geodesic_polyline_inverse(const double* latlon, size_t n,
+                                        double* s12, double* azi1,
+                                        double* azi2, double* a12,
+                                        double* cumulative, bool* ok) noexcept;
+
 EXTERN bool gnomonic_forward(double lat0, double lon0, double lat, double lon,
                              double* x, double* y) noexcept;
 
 EXTERN bool gnomonic_reverse(double lat0, double lon0, double x, double y,
                              double* lat, double* lon) noexcept;
 
+/**
+ * Solves the interception problem between a geodesic segment and a point
+ *
+ * The segment runs from (`lat1`, `lon1`) to (`lat2`, `lon2`) with azimuth
+ * `azi1` at its start and length `s12`.  Finds the point on the segment
+ * nearest (`latp`, `lonp`), returning it in `lati`, `loni` along with its
+ * geodesic distance `spi` from the point and `s1i` along the segment from the
+ * segment's start.
+ *
+ * Iterates at most `max_iterations` times, stopping early once an iteration
+ * moves the intercept by no more than `tolerance` meters.  The number of
+ * iterations actually performed is returned in `iterations`.
+ */
+EXTERN bool geodesic_intercept(double lat1, double lon1, double lat2,
+                               double lon2, double azi1, double s12,
+                               double latp, double lonp, double tolerance,
+                               unsigned max_iterations, double* lati,
+                               double* loni, double* spi, double* s1i,
+                               unsigned* iterations) noexcept;
+
 EXTERN bool geocentric_forward(double lat, double lon, double h, double* x,
                                double* y, double* z) noexcept;
 
+/**
+ * Converts `n` points on the surface of the ellipsoid to geocentric coordinates
+ *
+ * All arrays are of length `n`.  Equivalent to `geocentric_forward` at height
+ * zero, but written so that the compiler can vectorize the conversion loop;
+ * results agree with GeographicLib's to within nanometers.  `ok[i]` is set to
+ * whether the i-th point was converted, and the number of points converted
+ * successfully is returned.
+ */
+EXTERN size_t geocentric_forward_batch(const double* lat, const double* lon,
+                                       size_t n, double* x, double* y,
+                                       double* z, bool* ok) noexcept;
+
+/**
+ * The shim's instrumented entry points
+ *
+ * Each probe times whole calls, including any time spent in other probes
+ * called along the way: a route store's load includes its segments' inverse
+ * problems, for example.  `SHIM_STATS_INTERCEPT` counts every solution of the
+ * interception problem for a single point, and `SHIM_STATS_INTERCEPT_N` every
+ * segment's solution for several at once, including those made while
+ * matching waypoints.
+ */
+enum shim_stats_probe {
+  SHIM_STATS_INVERSE = 0,
+  SHIM_STATS_DIRECT = 1,
+  SHIM_STATS_POLYLINE_INVERSE = 2,
+  SHIM_STATS_GEOCENTRIC_BATCH = 3,
+  SHIM_STATS_INTERCEPT = 4,
+  SHIM_STATS_MATCH_WAYPOINTS = 5,
+  SHIM_STATS_ROUTE_STORE_LOAD = 6,
+  SHIM_STATS_ROUTE_STORE_FINISH = 7,
+  SHIM_STATS_SEGMENTER_PUSH = 8,
+  SHIM_STATS_CACHE_INVERSE = 9,
+  SHIM_STATS_CACHE_DIRECT = 10,
+  SHIM_STATS_INTERCEPT_N = 11,
+  SHIM_STATS_ROUTE_STORE_MOVE_POINT = 12,
+  SHIM_STATS_N_PROBES = 13,
+};
+
+/** The number of buckets in each probe's latency histogram */
+constexpr size_t SHIM_STATS_BUCKETS = 32;
+
+/**
+ * What one probe has recorded
+ *
+ * `histogram[k]` counts the calls that took at least 2^k and less than
+ * 2^(k+1) nanoseconds, except that the first bucket also counts calls that
+ * took no measurable time and the last counts every call longer than it.
+ */
+struct shim_probe_stats {
+  uint64_t calls;
+  uint64_t nanoseconds;
+  uint64_t histogram[SHIM_STATS_BUCKETS];
+};
+
+/**
+ * What every probe has recorded, indexed by `shim_stats_probe`
+ */
+struct shim_stats {
+  shim_probe_stats probes[SHIM_STATS_N_PROBES];
+};
+
+/**
+ * Turns the shim's probes on or off for the whole process
+ *
+ * Probes are off to begin with, so that calls pay only for checking them.
+ * Turning them on doesn't clear what they've recorded before.
+ */
+EXTERN void shim_stats_enable(bool enabled) noexcept;
+
+/**
+ * Copies what the probes have recorded into `stats`
+ *
+ * Calls still in flight on other threads may be partly counted: a call's
+ * count, time and histogram bucket are each updated separately.
+ */
+EXTERN void shim_stats_snapshot(shim_stats* stats) noexcept;
+
+/**
+ * Clears what the probes have recorded
+ */
+EXTERN void shim_stats_reset() noexcept;
+
 /**
  * Gets a string with GeographicLib's name and version number
  *
@@ -37,4 +668,15 @@ EXTERN const char* geographiclib_version() noexcept;
  */
 EXTERN const char* compiler_version() noexcept;
 
+/**
+ * Gets the name of the instruction set the batch kernels were dispatched to
+ *
+ * The geocentric batch and intercept floor mask kernels are compiled for
+ * several x86-64 instruction sets, one of which is picked on startup for the
+ * CPU the process is running on: "avx512", "avx2", or "generic" for the
+ * target's baseline.  Results are identical whichever is picked.  The string
+ * returned has static lifetime.
+ */
+EXTERN const char* shim_cpu_features() noexcept;
+
 #endif  // defined __COURSEPOINTER_SHIM_H__
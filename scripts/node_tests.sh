@@ -18,4 +18,4 @@ export CARGO_TARGET_WASM32_UNKNOWN_UNKNOWN_RUNNER
 WASM_BINDGEN_TEST_ONLY_NODE="1"
 export WASM_BINDGEN_TEST_ONLY_NODE
 
-cargo test --target wasm32-unknown-unknown --no-default-features -F jsffi
+cargo test --target wasm32-unknown-unknown --no-default-features -F jsffi -- "$@"
@@ -0,0 +1,43 @@
+#!/bin/bash
+
+# Builds the release CLI with its geocxx library optimized by profiles from
+# converting the integration test corpus.
+#
+# Extra arguments are passed to both cargo builds, e.g. -F cxx-lto.  With
+# Clang, the linker must be Clang too, so that the instrumented build links
+# Clang's profiling runtime: set CARGO_TARGET_<TRIPLE>_LINKER=clang or pass
+# -Clinker=clang in RUSTFLAGS.
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+PROFILE_DIR="${PROFILE_DIR:-$PWD/target/geocxx-pgo}"
+rm -rf "$PROFILE_DIR"
+mkdir -p "$PROFILE_DIR"
+
+GEOCXX_PGO_GENERATE="$PROFILE_DIR" cargo build --release -F cli "$@"
+
+TRAINING_DIR="$(mktemp -d)"
+trap 'rm -rf "$TRAINING_DIR"' EXIT
+gunzip -c docs/sample-files/RAGBRAI__Day_4_Gravel_Option.gpx.gz \
+       >"$TRAINING_DIR/RAGBRAI__Day_4_Gravel_Option.gpx"
+for gpx in integration/src/integration/data/*.gpx "$TRAINING_DIR"/*.gpx; do
+    # Some of the corpus is deliberately invalid, whose errors are part of
+    # the training too.
+    ./target/release/coursepointer convert --force \
+        -o "$TRAINING_DIR/$(basename "$gpx" .gpx).fit" "$gpx" >/dev/null 2>&1 ||
+        true
+done
+
+# GCC reads its .gcda files straight from the directory, but Clang's raw
+# profiles must be merged first.
+if compgen -G "$PROFILE_DIR/*.profraw" >/dev/null; then
+    "${LLVM_PROFDATA:-llvm-profdata}" merge -o "$PROFILE_DIR/geocxx.profdata" \
+        "$PROFILE_DIR"/*.profraw
+    PROFILE="$PROFILE_DIR/geocxx.profdata"
+else
+    PROFILE="$PROFILE_DIR"
+fi
+
+GEOCXX_PGO_USE="$PROFILE" cargo build --release -F cli "$@"
@@ -0,0 +1,28 @@
+#!/bin/bash
+
+# Times the course building pipeline end to end, on the RAGBRAI sample file
+# scaled from 1k to 10M track points with 10 to 100k waypoints.
+#
+# Extra arguments are passed to the native benchmark, e.g. --max-points
+# 1000000 or --probes.  Set WASM=1 to also run the jsffi build's benchmark in
+# node, which needs the tools from scripts/install_wasm_tools.sh and a built
+# GeographicLib module.
+
+set -e
+
+cd "$(dirname "$0")/.."
+
+BENCH_DIR="$(mktemp -d)"
+trap 'rm -rf "$BENCH_DIR"' EXIT
+gunzip -c docs/sample-files/RAGBRAI__Day_4_Gravel_Option.gpx.gz \
+       >"$BENCH_DIR/RAGBRAI__Day_4_Gravel_Option.gpx"
+
+cargo run --release --package devtools --bin pipeline-bench -- \
+      --gpx "$BENCH_DIR/RAGBRAI__Day_4_Gravel_Option.gpx" "$@"
+
+if [ -n "$WASM" ]; then
+    # The wasm benchmark can't read the sample file, so it starts from a
+    # synthetic track.  The native one's --synthetic compares like for like.
+    CARGO_PROFILE_DEV_OPT_LEVEL=3 \
+        scripts/node_tests.sh --include-ignored bench_pipeline
+fi
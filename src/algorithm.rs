@@ -11,9 +11,9 @@ use dimensioned::si::{M, Meter};
 use thiserror::Error;
 
 use crate::geographic::{
-    GeographicError, geodesic_direct, geodesic_inverse, gnomonic_forward, gnomonic_reverse,
+    GeographicError, InterceptOptions, Interception, geodesic_intercept, geodesic_inverse,
 };
-use crate::types::{GeoAndXyzPoint, GeoPoint, GeoSegment, HasGeoPoint, HasXyzPoint, XyPoint};
+use crate::types::{GeoAndXyzPoint, GeoPoint, GeoSegment, HasGeoPoint, HasXyzPoint};
 
 #[derive(Error, Debug)]
 #[non_exhaustive]
@@ -47,7 +47,7 @@ type Result<T> = std::result::Result<T, AlgorithmError>;
 ///    segment and the other point on a 2D plane.
 /// 3. Uses 2D geometry to get a better guess at the interception point.
 /// 4. Repeats a few times, each time re-centering the projection on the updated
-///    guess.
+///    guess, until the guess moves by less than a millimeter.
 ///
 /// # References
 ///
@@ -62,48 +62,35 @@ pub fn karney_interception<P>(segment: &GeoSegment<P>, point: &P) -> Result<GeoP
 where
     P: HasGeoPoint,
 {
-    // Start with an initial guess of an intercept at the geodesic's midpoint:
-    let mut intercept = geodesic_direct(
+    Ok(karney_interception_solution(segment, point, &InterceptOptions::default())?.point)
+}
+
+/// Compute a point of interception along with its distances
+///
+/// Like [`karney_interception`], but also returns the intercept's geodesic
+/// distance from the point and its offset along the segment from the
+/// segment's start.  The whole iteration runs in a single call to the C++
+/// shim, which computes these distances without further round trips.
+///
+/// Iteration stops once the intercept converges to within the tolerance given
+/// in `options`, and the returned solution reports how many iterations were
+/// actually used.
+pub fn karney_interception_solution<P>(
+    segment: &GeoSegment<P>,
+    point: &P,
+    options: &InterceptOptions,
+) -> Result<Interception>
+where
+    P: HasGeoPoint,
+{
+    Ok(geodesic_intercept(
         segment.start.geo(),
+        segment.end.geo(),
         segment.start_azimuth,
-        segment.geo_length / 2.0,
-    )?
-    .point2;
-
-    // TODO: Experiment with different numbers of gnomonic iterations
-    //
-    // I'm just using 10 iterations here because it's what Karney suggested in
-    // his example solution to the interception problem, and because it works ok
-    // in practice.  But it'd be worth checking whether a smaller number might
-    // work.
-    for _ in 0..10 {
-        let start = gnomonic_forward(&intercept, segment.start.geo())?;
-        let end = gnomonic_forward(&intercept, segment.end.geo())?;
-        let p = gnomonic_forward(&intercept, point.geo())?;
-        let b = subtract_xypoints(&end, &start);
-        let a = subtract_xypoints(&p, &start);
-
-        let v = if dot2(a, b) <= 0.0 {
-            Vec2 { x: 0.0, y: 0.0 }
-        } else {
-            let a_proj = b * (dot2(a, b) / dot2(b, b));
-            if dot2(a_proj, a_proj) >= dot2(b, b) {
-                b
-            } else {
-                a_proj
-            }
-        };
-
-        intercept = gnomonic_reverse(
-            &intercept,
-            &XyPoint {
-                x: (start.x.value_unsafe + v.x) * M,
-                y: (start.y.value_unsafe + v.y) * M,
-            },
-        )?;
-    }
-
-    Ok(intercept)
+        segment.geo_length,
+        point.geo(),
+        options,
+    )?)
 }
 
 /// Returns a floor for geodesic interception distance
@@ -277,34 +264,6 @@ where
     }
 }
 
-#[derive(Clone, Copy)]
-pub struct Vec2 {
-    pub x: f64,
-    pub y: f64,
-}
-
-impl Mul<f64> for Vec2 {
-    type Output = Self;
-
-    fn mul(self, rhs: f64) -> Self {
-        Self {
-            x: self.x * rhs,
-            y: self.y * rhs,
-        }
-    }
-}
-
-fn subtract_xypoints(a: &XyPoint, b: &XyPoint) -> Vec2 {
-    Vec2 {
-        x: a.x.value_unsafe - b.x.value_unsafe,
-        y: a.y.value_unsafe - b.y.value_unsafe,
-    }
-}
-
-fn dot2(a: Vec2, b: Vec2) -> f64 {
-    a.x * b.x + a.y * b.y
-}
-
 #[derive(Clone, Copy, Debug)]
 struct Vec3 {
     x: f64,
@@ -366,9 +325,9 @@ mod tests {
 
     use super::{
         FromGeoPoints, NearbySegment, cartesian_intercept_distance, find_nearby_segments,
-        intercept_distance_floor, karney_interception,
+        intercept_distance_floor, karney_interception, karney_interception_solution,
     };
-    use crate::geographic::{geocentric_forward, geodesic_inverse};
+    use crate::geographic::{InterceptOptions, geocentric_forward, geodesic_inverse};
     use crate::measure::DEG;
     use crate::types::{GeoAndXyzPoint, GeoPoint, GeoSegment, XyzPoint};
 
@@ -414,6 +373,39 @@ mod tests {
         Ok(())
     }
 
+    #[test]
+    fn test_karney_interception_convergence() -> Result<()> {
+        let intercepts_path = PathBuf::from(env!("CARGO_MANIFEST_DIR"))
+            .join("testdata")
+            .join("intercepts.csv");
+
+        let mut rdr = csv::ReaderBuilder::new()
+            .has_headers(false)
+            .from_path(intercepts_path)?;
+        for case in rdr.deserialize() {
+            let datum: InterceptsDatum = case?;
+            let geo_start =
+                GeoPoint::new(datum.geo_start_lat * DEG, datum.geo_start_lon * DEG, None)?;
+            let geo_end = GeoPoint::new(datum.geo_end_lat * DEG, datum.geo_end_lon * DEG, None)?;
+            let p = GeoPoint::new(datum.p_lat * DEG, datum.p_lon * DEG, None)?;
+            let seg = GeoSegment::from_geo_points(&geo_start, &geo_end)?;
+
+            let fixed = karney_interception_solution(&seg, &p, &InterceptOptions::fixed(10))?;
+            let converged = karney_interception_solution(&seg, &p, &InterceptOptions::default())?;
+
+            assert_eq!(fixed.iterations, 10);
+            assert!(converged.iterations >= 1 && converged.iterations <= 10);
+            assert_relative_eq!(converged.point, fixed.point, epsilon = 0.000_001);
+            assert_relative_eq!(
+                converged.offset.value_unsafe,
+                fixed.offset.value_unsafe,
+                epsilon = 0.01
+            );
+        }
+
+        Ok(())
+    }
+
     #[test]
     fn test_karney_interception_zero_length_segment() -> Result<()> {
         let seg_point = GeoPoint::new(3.0 * DEG, 4.0 * DEG, None)?;
@@ -438,6 +430,33 @@ mod tests {
         Ok(())
     }
 
+    #[test]
+    fn test_karney_interception_solution_distances() -> Result<()> {
+        let point1 = GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?;
+        let point2 = GeoPoint::new(37.25997 * DEG, -122.18813 * DEG, None)?;
+        let p = GeoPoint::new(37.25900 * DEG, -122.19300 * DEG, None)?;
+        let seg = GeoSegment::from_geo_points(&point1, &point2)?;
+        let solution = karney_interception_solution(&seg, &p, &InterceptOptions::default())?;
+
+        assert_relative_eq!(solution.point, karney_interception(&seg, &p)?);
+        assert_relative_eq!(
+            solution.distance.value_unsafe,
+            geodesic_inverse(&p, &solution.point)?
+                .geo_distance
+                .value_unsafe,
+            epsilon = 0.000_001
+        );
+        assert_relative_eq!(
+            solution.offset.value_unsafe,
+            geodesic_inverse(&point1, &solution.point)?
+                .geo_distance
+                .value_unsafe,
+            epsilon = 0.000_001
+        );
+        assert!(solution.offset <= seg.geo_length);
+        Ok(())
+    }
+
     impl NearbySegment<i32> for (char, i32) {
         fn waypoint_distance(self) -> i32 {
             self.1
@@ -587,7 +606,10 @@ mod qc {
     use quickcheck_macros::quickcheck;
 
     use super::{FromGeoPoints, intercept_distance_floor, karney_interception};
-    use crate::geographic::{geodesic_direct, geodesic_inverse};
+    use crate::geographic::{
+        GeodesicPath, GeodesicSolver, geodesic_direct, geodesic_inverse,
+        geodesic_inverse_with_solver,
+    };
     use crate::measure::DEG;
     use crate::types::{GeoAndXyzPoint, GeoPoint, GeoSegment};
 
@@ -648,6 +670,36 @@ mod qc {
         }
     }
 
+    /// Checks the automatic solver policy against the series solver on the
+    /// problem's segment
+    ///
+    /// Wherever the policy takes the tangent plane, its distance and the
+    /// lateral offset implied by its azimuth must stay within a tenth of a
+    /// millimeter of the series solution.
+    fn check_solver_problem<H>(h: H) -> Result<TestResult>
+    where
+        for<'a> H: HasInterceptProblem<'a>,
+    {
+        let series = geodesic_inverse(&h.prob().s1, &h.prob().s2)?;
+        let (auto, path) =
+            geodesic_inverse_with_solver(&h.prob().s1, &h.prob().s2, GeodesicSolver::Auto)?;
+        if path == GeodesicPath::TangentPlane && series.geo_distance > 1_000.0 * M {
+            return Ok(TestResult::failed());
+        }
+
+        let azimuth_error = (auto.azimuth1.value_unsafe - series.azimuth1.value_unsafe + 180.0)
+            .rem_euclid(360.0)
+            - 180.0;
+        let lateral = azimuth_error.abs().to_radians() * series.geo_distance;
+        if (auto.geo_distance - series.geo_distance).value_unsafe.abs() > 0.000_1
+            || lateral > 0.000_1 * M
+        {
+            Ok(TestResult::failed())
+        } else {
+            Ok(TestResult::passed())
+        }
+    }
+
     /// An intercept problem where the points are anywhere on the globe
     #[derive(Clone, Debug)]
     struct GlobalInterceptProblem {
@@ -738,6 +790,11 @@ mod qc {
                 fn [<qc_ $name _intercept_floor>](prob: LocalInterceptProblem<[<Radius $name>]>) -> Result<TestResult> {
                     check_intercept_problem(prob)
                 }
+
+                #[quickcheck]
+                fn [<qc_ $name _auto_solver>](prob: LocalInterceptProblem<[<Radius $name>]>) -> Result<TestResult> {
+                    check_solver_problem(prob)
+                }
             }
         }
     }
@@ -8,8 +8,14 @@ use anyhow::{Context, Result, anyhow, bail};
 use clap::builder::styling::Styles;
 use clap::{Args, ColorChoice, Parser, Subcommand, ValueEnum, crate_version};
 use clap_cargo::style::{ERROR, HEADER, INVALID, LITERAL, PLACEHOLDER, USAGE, VALID};
-use coursepointer::course::{CourseSetOptions, InterceptStrategy};
-use coursepointer::internal::{Kilometer, Mile, compiler_version_str, geographiclib_version_str};
+use coursepointer::course::{
+    CourseSetOptions, GeodesicSolver, InterceptStrategy, PrefilterPrecision,
+};
+use coursepointer::internal::report::shim_stats_report;
+use coursepointer::internal::{
+    Kilometer, Mile, compiler_version_str, geographiclib_version_str, shim_cpu_features_str,
+    shim_stats_enable, shim_stats_snapshot,
+};
 use coursepointer::{
     ConversionInfo, CoursePointType, CoursePointerError, FitCourseOptions, FitEncodeError, Sport,
 };
@@ -35,11 +41,12 @@ pub const CLAP_STYLING: Styles = Styles::styled()
 
 static LONG_VERSION: LazyLock<String> = LazyLock::new(|| {
     format!(
-        "{} ({}, rustc {}, {})",
+        "{} ({}, rustc {}, {}, {} kernels)",
         crate_version!(),
         geographiclib_version_str(),
         env!("RUSTC_VERSION"),
         compiler_version_str(),
+        shim_cpu_features_str(),
     )
 });
 
@@ -80,6 +87,14 @@ struct Cli {
     /// system locale.
     #[clap(long, short = 'u', default_value_t = DistUnit::Autodetect)]
     distance_unit: DistUnit,
+
+    /// Time the GeographicLib shim's entry points
+    ///
+    /// Prints each entry point's call count and latency to stderr on exit.
+    /// Times include those of any other entry points a call makes, so that
+    /// matching waypoints includes the time spent solving their interceptions.
+    #[clap(long, action)]
+    profile: bool,
 }
 
 #[derive(Copy, Clone, Display, ValueEnum)]
@@ -181,6 +196,20 @@ struct ConvertArgs {
     /// course from a waypoint.
     #[clap(long, short = 'r', default_value_t = InterceptStrategy::Nearest)]
     strategy: InterceptStrategy,
+
+    /// How to solve for the distance along each segment of the course.
+    #[clap(long, default_value_t = GeodesicSolver::Series)]
+    geodesic_solver: GeodesicSolver,
+
+    /// Precision in which route segments are filtered by their distance from
+    /// each waypoint, before the candidates are solved exactly.
+    #[clap(long, default_value_t = PrefilterPrecision::Double)]
+    prefilter_precision: PrefilterPrecision,
+
+    /// Number of segment solutions to remember, so that segments the course
+    /// retraces are only solved once. Zero disables the cache.
+    #[clap(long, default_value_t = 0)]
+    geodesic_cache_size: usize,
 }
 
 #[derive(Args, Debug)]
@@ -274,7 +303,10 @@ fn convert_cmd(args: &Cli, sub_args: &ConvertArgs) -> Result<String> {
 
     let course_options = CourseSetOptions::default()
         .with_threshold(sub_args.threshold * M)
-        .with_strategy(sub_args.strategy);
+        .with_strategy(sub_args.strategy)
+        .with_geodesic_solver(sub_args.geodesic_solver)
+        .with_prefilter_precision(sub_args.prefilter_precision)
+        .with_geodesic_cache(sub_args.geodesic_cache_size);
     let fit_options = FitCourseOptions::default()
         .with_speed(sub_args.speed * KILO * M / HR)
         .with_sport(sub_args.sport)
@@ -378,11 +410,18 @@ fn main() -> Result<()> {
 
     debug!("coursepointer {}", clap::crate_version!());
 
+    if args.profile {
+        shim_stats_enable(true);
+    }
+
     let report = match &args.cmd {
         Commands::Convert(sub_args) => convert_cmd(&args, sub_args),
         Commands::License => license_cmd(),
     }?;
 
     print!("{report}");
+    if args.profile {
+        eprint!("\n{}", shim_stats_report(&shim_stats_snapshot()?)?);
+    }
     Ok(())
 }
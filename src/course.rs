@@ -47,6 +47,10 @@
 //! returns a [`CourseSet`] containing [`Course`] instances, which in turn will
 //! contain any identified [`CoursePoint`] instances.
 //!
+//! For a single course being edited interactively, [`CourseEditor`] keeps its
+//! route and waypoint matches loaded between edits, and works out just the
+//! course points each edit changes.
+//!
 //! # Units of measure
 //!
 //! Courses and related types here use zero-cost unit of measure types from
@@ -68,18 +72,23 @@
 //! ```
 
 use std::cmp::Ordering;
+use std::collections::{BTreeMap, BTreeSet};
+use std::ops::Range;
 
 use dimensioned::si::{M, Meter};
 #[cfg(feature = "rayon")]
 use rayon::prelude::*;
 use thiserror::Error;
-use tracing::{debug, info};
+use tracing::{Level, debug, enabled, info};
 
-use crate::algorithm::{
-    AlgorithmError, FromGeoPoints, NearbySegment, find_nearby_segments, intercept_distance_floor,
-    karney_interception,
+use crate::algorithm::{AlgorithmError, NearbySegment, find_nearby_segments};
+pub use crate::geographic::{
+    GeodesicCache, GeodesicCacheStats, GeodesicSolver, PrefilterPrecision,
+};
+use crate::geographic::{
+    GeographicError, InterceptOptions, Interception, RouteStore, WaypointColumns, WaypointMatch,
+    match_waypoints, match_waypoints_in_segments,
 };
-use crate::geographic::{GeographicError, geodesic_inverse};
 use crate::types::{GeoAndXyzPoint, GeoSegment, HasGeoPoint, TypeError};
 use crate::{CoursePointType, GeoPoint};
 
@@ -113,6 +122,9 @@ macro_rules! iter_work {
     };
 }
 
+/// The number of waypoints matched against a course per matching engine call
+const WAYPOINT_BATCH_SIZE: usize = 64;
+
 /// Options for building a course set
 #[derive(Clone, Debug)]
 pub struct CourseSetOptions {
@@ -124,6 +136,20 @@ pub struct CourseSetOptions {
     /// What strategy to apply when a waypoint intercepts a single route
     /// multiple times.
     strategy: InterceptStrategy,
+
+    /// Convergence criteria for solving waypoint interceptions.
+    intercept: InterceptOptions,
+
+    /// How to solve the inverse problem along each route segment.
+    solver: GeodesicSolver,
+
+    /// The precision in which route segments are filtered by their distance
+    /// floors from each waypoint.
+    prefilter: PrefilterPrecision,
+
+    /// The number of segment solutions to remember across the routes of a
+    /// set, or zero to solve every segment afresh.
+    cache_capacity: usize,
 }
 
 /// A strategy for handling duplicate intercepts from a waypoint.
@@ -152,6 +178,10 @@ impl Default for CourseSetOptions {
         Self {
             threshold: 35.0 * M,
             strategy: InterceptStrategy::Nearest,
+            intercept: InterceptOptions::default(),
+            solver: GeodesicSolver::default(),
+            prefilter: PrefilterPrecision::default(),
+            cache_capacity: 0,
         }
     }
 }
@@ -165,6 +195,10 @@ impl CourseSetOptions {
         Self {
             threshold,
             strategy: self.strategy,
+            intercept: self.intercept,
+            solver: self.solver,
+            prefilter: self.prefilter,
+            cache_capacity: self.cache_capacity,
         }
     }
 
@@ -176,6 +210,102 @@ impl CourseSetOptions {
         Self {
             threshold: self.threshold,
             strategy,
+            intercept: self.intercept,
+            solver: self.solver,
+            prefilter: self.prefilter,
+            cache_capacity: self.cache_capacity,
+        }
+    }
+
+    /// Sets the convergence tolerance for interception
+    ///
+    /// Interception iteratively refines its estimate of the point along a
+    /// route nearest a waypoint, stopping once an iteration moves the estimate
+    /// by no more than this distance.
+    pub fn with_intercept_tolerance(self, tolerance: Meter<f64>) -> Self {
+        Self {
+            threshold: self.threshold,
+            strategy: self.strategy,
+            intercept: InterceptOptions {
+                tolerance,
+                max_iterations: self.intercept.max_iterations,
+            },
+            solver: self.solver,
+            prefilter: self.prefilter,
+            cache_capacity: self.cache_capacity,
+        }
+    }
+
+    /// Sets the maximum number of interception iterations
+    ///
+    /// Limits how many times interception will refine its estimate of a
+    /// waypoint's nearest point along a route segment.
+    pub fn with_max_intercept_iterations(self, max_iterations: u32) -> Self {
+        Self {
+            threshold: self.threshold,
+            strategy: self.strategy,
+            intercept: InterceptOptions {
+                tolerance: self.intercept.tolerance,
+                max_iterations,
+            },
+            solver: self.solver,
+            prefilter: self.prefilter,
+            cache_capacity: self.cache_capacity,
+        }
+    }
+
+    /// Sets the solver policy for route segments
+    ///
+    /// Chooses how the inverse geodesic problem is solved between adjacent
+    /// route points.  [`GeodesicSolver::Auto`] is usually much faster on
+    /// densely sampled tracks, at the cost of distances that may differ from
+    /// the default series solution by up to a tenth of a millimeter per
+    /// segment.
+    pub fn with_geodesic_solver(self, solver: GeodesicSolver) -> Self {
+        Self {
+            threshold: self.threshold,
+            strategy: self.strategy,
+            intercept: self.intercept,
+            solver,
+            prefilter: self.prefilter,
+            cache_capacity: self.cache_capacity,
+        }
+    }
+
+    /// Sets the precision of the route segment prefilter
+    ///
+    /// Waypoints are only solved against the route segments whose distance
+    /// floors are within the threshold.  [`PrefilterPrecision::Single`]
+    /// computes those floors in single precision, which is faster on routes
+    /// with many segments, and widens them by a bound on their rounding error,
+    /// so that it never rejects a segment the default would keep.
+    pub fn with_prefilter_precision(self, prefilter: PrefilterPrecision) -> Self {
+        Self {
+            threshold: self.threshold,
+            strategy: self.strategy,
+            intercept: self.intercept,
+            solver: self.solver,
+            prefilter,
+            cache_capacity: self.cache_capacity,
+        }
+    }
+
+    /// Sets the capacity of the memo cache for route segments
+    ///
+    /// Route variants in one set often share most of their points, and
+    /// out-and-back courses retrace their own segments in reverse.  With a
+    /// nonzero capacity, segments are solved through a [`GeodesicCache`] shared
+    /// by every route in the set, which remembers up to about this many
+    /// solutions, so that repeated segments are only solved once.  Its hit
+    /// rates are reported in [`CourseSet::geodesic_cache_stats`].
+    pub fn with_geodesic_cache(self, cache_capacity: usize) -> Self {
+        Self {
+            threshold: self.threshold,
+            strategy: self.strategy,
+            intercept: self.intercept,
+            solver: self.solver,
+            prefilter: self.prefilter,
+            cache_capacity,
         }
     }
 }
@@ -189,6 +319,10 @@ pub struct CourseSet {
     /// may be greater than the number of course points that were actually
     /// resolved for the course(s).
     pub num_waypoints: usize,
+
+    /// Counts of the lookups served by the memo cache for route segments, if
+    /// it was enabled with [`CourseSetOptions::with_geodesic_cache`].
+    pub geodesic_cache_stats: Option<GeodesicCacheStats>,
 }
 
 /// A navigation course
@@ -329,10 +463,24 @@ impl CourseSetBuilder {
     pub fn build(mut self) -> Result<CourseSet> {
         let mut courses = Vec::new();
         let mut course_builders = std::mem::take(&mut self.route_builders);
+        let cache = match self.options.cache_capacity {
+            0 => None,
+            capacity => Some(GeodesicCache::new(capacity)?),
+        };
         let mut segmented_courses = course_builders
             .iter_mut()
-            .map(|c| c.segment())
+            .map(|c| c.segment(self.options.solver, self.options.prefilter, cache.as_ref()))
             .collect::<Result<Vec<_>>>()?;
+        let geodesic_cache_stats = cache.map(|cache| cache.stats());
+        if let Some(stats) = geodesic_cache_stats {
+            debug!(
+                "Segment cache hit {:.1}% of lookups ({} hit, {} reversed, {} missed)",
+                100.0 * stats.inverse_hit_rate(),
+                stats.inverse_hits,
+                stats.inverse_reversed_hits,
+                stats.inverse_misses
+            );
+        }
         self.process_waypoints(&mut segmented_courses)?;
         for segmented_course in segmented_courses {
             courses.push(segmented_course.build()?);
@@ -340,45 +488,106 @@ impl CourseSetBuilder {
         Ok(CourseSet {
             courses,
             num_waypoints: self.waypoints.len(),
+            geodesic_cache_stats,
         })
     }
 
-    fn solve_near_intercept(
-        segment: &GeoSegment<GeoAndXyzPoint>,
-        waypoint: &Waypoint<GeoAndXyzPoint>,
-        course_distance: Meter<f64>,
-    ) -> Result<InterceptSolution> {
-        let intercept = karney_interception(segment, &waypoint.point)?;
-        let distance = geodesic_inverse(waypoint.point.geo(), &intercept)?.geo_distance;
-        if distance.value_unsafe.is_nan() {
+    /// The interception a match found, if it was solved with a distance
+    fn interception(waypoint_match: WaypointMatch) -> Result<Interception> {
+        let solution = waypoint_match.interception?;
+        if solution.distance.value_unsafe.is_nan() {
             return Err(CourseError::NaNDistance);
         }
-        let offset = geodesic_inverse(segment.start.geo(), &intercept)?.geo_distance;
+        Ok(solution)
+    }
 
-        Ok(InterceptSolution::Near(NearIntercept {
-            intercept_point: intercept,
-            intercept_distance: distance,
-            course_distance: course_distance + offset,
-        }))
+    /// An interception with a segment starting `start_distance` along the
+    /// course
+    fn near_intercept(start_distance: Meter<f64>, solution: &Interception) -> NearIntercept {
+        NearIntercept {
+            intercept_point: solution.point,
+            intercept_distance: solution.distance,
+            course_distance: start_distance + solution.offset,
+            iterations: solution.iterations,
+        }
     }
 
-    fn process_single_waypoint(
-        waypoint: &Waypoint<GeoAndXyzPoint>,
+    /// Appends a waypoint's intercept with `segment` to its solutions, after
+    /// an [`InterceptSolution::Far`] gap unless the last one appended was with
+    /// the segment before
+    fn push_near_intercept(
+        slns: &mut Vec<InterceptSolution>,
+        last_segment: &mut Option<usize>,
+        segment: usize,
+        near: NearIntercept,
+    ) {
+        if last_segment.is_some_and(|last| last + 1 != segment) {
+            slns.push(InterceptSolution::Far);
+        }
+        *last_segment = Some(segment);
+        slns.push(InterceptSolution::Near(near));
+    }
+
+    /// Finds the near intercepts between a course and each of a chunk of
+    /// waypoints
+    ///
+    /// Matches the whole chunk against the course in a single call into the
+    /// shim's matching engine, which only reports segments passing within the
+    /// threshold.  Other segments are represented by [`InterceptSolution::Far`]
+    /// gaps, so that [`find_nearby_segments`] still sees each run of adjacent
+    /// nearby segments as a separate span.
+    fn process_waypoint_chunk(
+        waypoints: &[Waypoint<GeoAndXyzPoint>],
         course: &SegmentedCourseBuilder,
-        threshold: Meter<f64>,
-    ) -> Result<Vec<NearIntercept>> {
-        let mut slns = Vec::new();
-        for (segment, start_distance) in &course.segments_and_distances {
-            slns.push(
-                if intercept_distance_floor(segment, &waypoint.point)? > threshold {
-                    InterceptSolution::Far
-                } else {
-                    Self::solve_near_intercept(segment, waypoint, *start_distance)?
-                },
-            );
+        options: &CourseSetOptions,
+    ) -> Result<Vec<Vec<NearIntercept>>> {
+        let points = waypoints.iter().map(|w| w.point).collect::<Vec<_>>();
+        let matches = match_waypoints(
+            &course.route,
+            &points,
+            options.threshold,
+            &options.intercept,
+        );
+
+        let mut slns = vec![Vec::new(); waypoints.len()];
+        let mut last_segments = vec![None; waypoints.len()];
+        for waypoint_match in matches {
+            let w = waypoint_match.waypoint;
+            let segment = waypoint_match.segment;
+            let (_, start_distance) = course.segments_and_distances[segment];
+            let near = Self::near_intercept(start_distance, &Self::interception(waypoint_match)?);
+            Self::push_near_intercept(&mut slns[w], &mut last_segments[w], segment, near);
         }
 
-        let near_intercepts = find_nearby_segments(&slns, threshold)
+        Ok(waypoints
+            .iter()
+            .zip(slns)
+            .map(|(waypoint, slns)| Self::near_intercepts(waypoint, &slns, options))
+            .collect())
+    }
+
+    fn near_intercepts(
+        waypoint: &Waypoint<GeoAndXyzPoint>,
+        slns: &[InterceptSolution],
+        options: &CourseSetOptions,
+    ) -> Vec<NearIntercept> {
+        if enabled!(Level::DEBUG) {
+            // Histogram of the number of iterations each interception took to
+            // converge, indexed by iteration count.
+            let near = || {
+                slns.iter().filter_map(|sln| match sln {
+                    InterceptSolution::Near(near) => Some(near.iterations as usize),
+                    InterceptSolution::Far => None,
+                })
+            };
+            let mut iterations = vec![0usize; near().max().map_or(0, |max| max + 1)];
+            for n in near() {
+                iterations[n] += 1;
+            }
+            debug!(?iterations, "Interception iterations");
+        }
+
+        let near_intercepts = find_nearby_segments(slns, options.threshold)
             .iter()
             .filter_map(|sln| match sln {
                 InterceptSolution::Near(near) => Some(*near),
@@ -393,68 +602,87 @@ impl CourseSetBuilder {
             info!(
                 intercept_dist = ?seg.intercept_distance,
                 course_dist = %seg.course_distance,
+                iterations = seg.iterations,
                 "Intercept",
             );
         }
-        Ok(near_intercepts)
+        near_intercepts
     }
 
     #[tracing::instrument(level = "debug", name = "process_waypoints", skip_all)]
     fn process_waypoints(&self, segmented_courses: &mut Vec<SegmentedCourseBuilder>) -> Result<()> {
-        for segmented_course in segmented_courses {
-            let waypoints_and_intercepts = iter_work!(&self.waypoints)
-                .map(|waypoint| {
-                    let xyz_waypoint: Waypoint<GeoAndXyzPoint> = waypoint.clone().try_into()?;
-                    let near_intercepts = Self::process_single_waypoint(
-                        &xyz_waypoint,
-                        segmented_course,
-                        self.options.threshold,
-                    )?;
-                    Ok((xyz_waypoint, near_intercepts))
-                })
-                .collect::<Result<Vec<_>>>()?;
-
-            for (waypoint, near_intercepts) in waypoints_and_intercepts.iter() {
-                if !near_intercepts.is_empty() {
-                    match self.options.strategy {
-                        InterceptStrategy::Nearest => {
-                            let mut near_sorted = near_intercepts.clone();
-                            near_sorted.sort_by(|a, b| {
-                                a.intercept_distance
-                                    .partial_cmp(&b.intercept_distance)
-                                    .unwrap()
-                            });
-                            Self::add_course_point(
-                                &mut segmented_course.course_points,
-                                &near_sorted[0],
-                                waypoint,
-                            );
-                        }
-
-                        InterceptStrategy::First => {
-                            Self::add_course_point(
-                                &mut segmented_course.course_points,
-                                &near_intercepts[0],
-                                waypoint,
-                            );
-                        }
-
-                        InterceptStrategy::All => {
-                            for sln in near_intercepts {
-                                Self::add_course_point(
-                                    &mut segmented_course.course_points,
-                                    sln,
-                                    waypoint,
-                                );
-                            }
-                        }
-                    }
-                }
+        let xyz_waypoints = iter_work!(&self.waypoints)
+            .map(|waypoint| Ok(waypoint.clone().try_into()?))
+            .collect::<Result<Vec<Waypoint<GeoAndXyzPoint>>>>()?;
+
+        // Match each course against a chunk of waypoints at a time, so that
+        // each call into the matching engine covers many waypoint and segment
+        // pairs while still leaving work to spread across threads, whether the
+        // set has many courses or many waypoints.  The shim's solvers share no
+        // mutable state, so these can run concurrently.
+        let jobs = (0..segmented_courses.len())
+            .flat_map(|c| {
+                (0..xyz_waypoints.len())
+                    .step_by(WAYPOINT_BATCH_SIZE)
+                    .map(move |start| (c, start))
+            })
+            .collect::<Vec<_>>();
+        let courses = &*segmented_courses;
+        let job_intercepts = iter_work!(jobs)
+            .map(|&(c, start)| {
+                let end = (start + WAYPOINT_BATCH_SIZE).min(xyz_waypoints.len());
+                Self::process_waypoint_chunk(&xyz_waypoints[start..end], &courses[c], &self.options)
+            })
+            .collect::<Result<Vec<_>>>()?;
+
+        for (&(c, start), chunk_intercepts) in jobs.iter().zip(job_intercepts.iter()) {
+            let segmented_course = &mut segmented_courses[c];
+            for (i, near_intercepts) in chunk_intercepts.iter().enumerate() {
+                Self::add_course_points(
+                    &mut segmented_course.course_points,
+                    near_intercepts,
+                    &xyz_waypoints[start + i],
+                    self.options.strategy,
+                );
             }
         }
         Ok(())
     }
 
+    /// Adds the course points a waypoint's near intercepts make under
+    /// `strategy`
+    fn add_course_points(
+        course_points: &mut Vec<CoursePoint>,
+        near_intercepts: &[NearIntercept],
+        waypoint: &Waypoint<GeoAndXyzPoint>,
+        strategy: InterceptStrategy,
+    ) {
+        if near_intercepts.is_empty() {
+            return;
+        }
+        match strategy {
+            InterceptStrategy::Nearest => {
+                let mut near_sorted = near_intercepts.to_vec();
+                near_sorted.sort_by(|a, b| {
+                    a.intercept_distance
+                        .partial_cmp(&b.intercept_distance)
+                        .unwrap()
+                });
+                Self::add_course_point(course_points, &near_sorted[0], waypoint);
+            }
+
+            InterceptStrategy::First => {
+                Self::add_course_point(course_points, &near_intercepts[0], waypoint);
+            }
+
+            InterceptStrategy::All => {
+                for sln in near_intercepts {
+                    Self::add_course_point(course_points, sln, waypoint);
+                }
+            }
+        }
+    }
+
     fn add_course_point(
         course_points: &mut Vec<CoursePoint>,
         sln: &NearIntercept,
@@ -469,6 +697,363 @@ impl CourseSetBuilder {
     }
 }
 
+/// How an edit through a [`CourseEditor`] changed its course points
+#[derive(Clone, Debug, PartialEq)]
+pub struct CourseDelta {
+    /// The waypoints whose course points were found again, by index, each with
+    /// all of its course points after the edit, if any.
+    pub changed: Vec<(usize, Vec<CoursePoint>)>,
+
+    /// Every other waypoint's course points at or past this course distance,
+    /// as it was before the edit, have moved by `shift`.
+    pub shift_after: Meter<f64>,
+
+    /// How far the course points past `shift_after` moved, which is how much
+    /// longer the edit made the course.
+    pub shift: Meter<f64>,
+}
+
+/// A single course kept loaded for interactive editing
+///
+/// Where [`CourseSetBuilder`] solves a whole set of routes and waypoints at
+/// once, an editor keeps one route loaded, along with its waypoints' matches,
+/// between edits.  Moving a route point then re-solves and re-matches only the
+/// two segments it ends, and adding a waypoint only matches that waypoint.
+/// Each edit returns a [`CourseDelta`] of the course points it changed, and
+/// [`CourseEditor::course`] gives the whole course.  Either gives just what
+/// [`CourseSetBuilder::build`] would for the edited route and waypoints.
+///
+/// As with [`RouteBuilder`], a route point equal to the one before it isn't
+/// loaded, though edits still number route points as the caller gave them.
+/// Moving a point onto a neighbour, or off one, changes how many points are
+/// loaded, so that move reloads and re-matches the whole route instead.
+/// Segments are never solved through a geodesic cache.
+pub struct CourseEditor {
+    options: CourseSetOptions,
+    route_points: Vec<GeoPoint>,
+    route: RouteStore,
+
+    /// The index in `route` of each of the caller's route points, which a
+    /// repeated point shares with the point it repeats
+    loaded: Vec<usize>,
+
+    waypoints: Vec<Waypoint<GeoAndXyzPoint>>,
+
+    /// The waypoints' coordinates, laid out once for matching after each edit
+    columns: WaypointColumns,
+
+    /// Each waypoint's interceptions within the threshold, ordered by segment
+    matches: Vec<Vec<(usize, Interception)>>,
+
+    /// The segment and waypoint of every interception in `matches`, to find
+    /// the waypoints near the segments an edit changes
+    pairs: BTreeSet<(usize, usize)>,
+}
+
+impl CourseEditor {
+    /// Loads a route for editing, to be solved and matched with `options`
+    pub fn new(options: CourseSetOptions, route_points: Vec<GeoPoint>) -> Result<Self> {
+        let (route, loaded) = Self::load(&options, &route_points)?;
+        Ok(Self {
+            options,
+            route_points,
+            route,
+            loaded,
+            waypoints: Vec::new(),
+            columns: WaypointColumns::default(),
+            matches: Vec::new(),
+            pairs: BTreeSet::new(),
+        })
+    }
+
+    /// Loads the route points that don't repeat the one before them, failing
+    /// if any point or segment can't be solved, and numbers each route point
+    /// by the loaded point it is or repeats
+    fn load(
+        options: &CourseSetOptions,
+        route_points: &[GeoPoint],
+    ) -> Result<(RouteStore, Vec<usize>)> {
+        let mut points = Vec::with_capacity(route_points.len());
+        let mut loaded = Vec::with_capacity(route_points.len());
+        for point in route_points {
+            if points.last() != Some(point) {
+                points.push(*point);
+            }
+            loaded.push(points.len() - 1);
+        }
+
+        let route = RouteStore::new(&points, options.solver, options.prefilter, None)?;
+        for i in 0..route.num_points() {
+            route.xyz_point(i)?;
+        }
+        for i in 0..route.num_segments() {
+            route.segment(i)?;
+        }
+        debug!(
+            points = route.num_points(),
+            repeated = route_points.len() - route.num_points(),
+            indexed = route.is_indexed(),
+            "Loaded route for editing",
+        );
+        Ok((route, loaded))
+    }
+
+    /// The route's points, as edited, including any repeated points
+    pub fn route_points(&self) -> &[GeoPoint] {
+        &self.route_points
+    }
+
+    /// The loaded route's total distance
+    fn length(&self) -> Meter<f64> {
+        match self.route.num_points() {
+            0 => 0.0 * M,
+            n => self.route.cumulative_distance(n - 1),
+        }
+    }
+
+    /// The number of waypoints added so far
+    pub fn num_waypoints(&self) -> usize {
+        self.waypoints.len()
+    }
+
+    /// Adds a waypoint, matching it against the whole route
+    ///
+    /// Its index is the number of waypoints added before it.
+    pub fn add_waypoint(
+        &mut self,
+        point: GeoPoint,
+        point_type: CoursePointType,
+        name: String,
+    ) -> Result<CourseDelta> {
+        let waypoint = Waypoint::<GeoAndXyzPoint>::try_from(Waypoint {
+            point,
+            point_type,
+            name,
+        })?;
+        let matches = match_waypoints(
+            &self.route,
+            &[waypoint.point],
+            self.options.threshold,
+            &self.options.intercept,
+        )
+        .into_iter()
+        .map(|m| Ok((m.segment, CourseSetBuilder::interception(m)?)))
+        .collect::<Result<Vec<_>>>()?;
+
+        let w = self.waypoints.len();
+        self.pairs
+            .extend(matches.iter().map(|(segment, _)| (*segment, w)));
+        self.columns.push(&waypoint.point);
+        self.waypoints.push(waypoint);
+        self.matches.push(matches);
+        Ok(CourseDelta {
+            changed: vec![(w, self.course_points(w))],
+            shift_after: self.length(),
+            shift: 0.0 * M,
+        })
+    }
+
+    /// Moves route point `i` to `point`
+    ///
+    /// Only the segments on either side of the point are solved again, and
+    /// only the waypoints near them before or after the move are matched
+    /// against them again.  If the edit fails, the course is left as it was.
+    ///
+    /// A move still takes time linear in the route and in the waypoints,
+    /// though with no geodesics: every cumulative distance after the point is
+    /// summed again, and every waypoint is prefiltered against the two
+    /// segments, with only those that pass intercepted.  A move onto or off a
+    /// neighbouring point instead loads and matches the route from scratch,
+    /// returning every waypoint as changed.
+    ///
+    /// # Panics
+    ///
+    /// If `i` is out of range.
+    pub fn move_route_point(&mut self, i: usize, point: GeoPoint) -> Result<CourseDelta> {
+        let old_point = self.route_points[i];
+        let repeats = |p: &GeoPoint| {
+            (i > 0 && self.route_points[i - 1] == *p) || self.route_points.get(i + 1) == Some(p)
+        };
+        if repeats(&old_point) || repeats(&point) {
+            return self.reload(i, point);
+        }
+
+        // Neither point repeats a neighbour, so the moved point is loaded on
+        // its own.
+        let j = self.loaded[i];
+        let segments = j.saturating_sub(1)..(j + 1).min(self.route.num_segments());
+        let shift_after = self.route.cumulative_distance(segments.end);
+        let rematched = self
+            .route
+            .move_point(j, &point)
+            .map_err(CourseError::from)
+            .and_then(|()| self.rematch(segments.clone()));
+        let rematched = match rematched {
+            Ok(rematched) => rematched,
+            Err(e) => {
+                self.route.move_point(j, &old_point)?;
+                return Err(e);
+            }
+        };
+        self.route_points[i] = point;
+
+        let stale = self
+            .pairs
+            .range((segments.start, 0)..(segments.end, 0))
+            .copied()
+            .collect::<Vec<_>>();
+        for pair in stale {
+            self.pairs.remove(&pair);
+        }
+        let mut changed = Vec::with_capacity(rematched.len());
+        for (w, matches) in rematched {
+            self.pairs.extend(
+                matches
+                    .iter()
+                    .filter(|(segment, _)| segments.contains(segment))
+                    .map(|(segment, _)| (*segment, w)),
+            );
+            self.matches[w] = matches;
+            changed.push((w, self.course_points(w)));
+        }
+        Ok(CourseDelta {
+            changed,
+            shift_after,
+            shift: self.route.cumulative_distance(segments.end) - shift_after,
+        })
+    }
+
+    /// Moves route point `i` to `point` by loading the moved route and matching
+    /// every waypoint against it afresh, leaving the course as it was if that
+    /// fails
+    fn reload(&mut self, i: usize, point: GeoPoint) -> Result<CourseDelta> {
+        let mut route_points = self.route_points.clone();
+        route_points[i] = point;
+        let (route, loaded) = Self::load(&self.options, &route_points)?;
+        let mut matches = vec![Vec::new(); self.waypoints.len()];
+        for m in match_waypoints_in_segments(
+            &route,
+            0..route.num_segments(),
+            &self.columns,
+            self.options.threshold,
+            &self.options.intercept,
+        ) {
+            let w = m.waypoint;
+            matches[w].push((m.segment, CourseSetBuilder::interception(m)?));
+        }
+
+        let shift_after = self.length();
+        self.route_points = route_points;
+        self.route = route;
+        self.loaded = loaded;
+        self.pairs = matches
+            .iter()
+            .enumerate()
+            .flat_map(|(w, matches)| matches.iter().map(move |(segment, _)| (*segment, w)))
+            .collect();
+        self.matches = matches;
+        Ok(CourseDelta {
+            changed: (0..self.waypoints.len())
+                .map(|w| (w, self.course_points(w)))
+                .collect(),
+            shift_after,
+            shift: self.length() - shift_after,
+        })
+    }
+
+    /// Matches every waypoint against `segments` after they've been edited,
+    /// returning each waypoint near them before or after, with its matches
+    /// elsewhere and its new matches on them
+    fn rematch(&self, segments: Range<usize>) -> Result<Vec<(usize, Vec<(usize, Interception)>)>> {
+        let mut fresh = self
+            .pairs
+            .range((segments.start, 0)..(segments.end, 0))
+            .map(|&(_, w)| (w, Vec::new()))
+            .collect::<BTreeMap<_, _>>();
+        for m in match_waypoints_in_segments(
+            &self.route,
+            segments.clone(),
+            &self.columns,
+            self.options.threshold,
+            &self.options.intercept,
+        ) {
+            fresh
+                .entry(m.waypoint)
+                .or_default()
+                .push((m.segment, CourseSetBuilder::interception(m)?));
+        }
+
+        Ok(fresh
+            .into_iter()
+            .map(|(w, near)| {
+                let mut matches = self.matches[w]
+                    .iter()
+                    .filter(|(segment, _)| !segments.contains(segment))
+                    .copied()
+                    .chain(near)
+                    .collect::<Vec<_>>();
+                matches.sort_by_key(|(segment, _)| *segment);
+                (w, matches)
+            })
+            .collect())
+    }
+
+    /// Waypoint `w`'s course points, found from its matches as
+    /// [`CourseSetBuilder`] finds them
+    fn course_points(&self, w: usize) -> Vec<CoursePoint> {
+        let mut slns = Vec::new();
+        let mut last_segment = None;
+        for (segment, solution) in &self.matches[w] {
+            let start_distance = self.route.cumulative_distance(*segment);
+            let near = CourseSetBuilder::near_intercept(start_distance, solution);
+            CourseSetBuilder::push_near_intercept(&mut slns, &mut last_segment, *segment, near);
+        }
+
+        let waypoint = &self.waypoints[w];
+        let near_intercepts = CourseSetBuilder::near_intercepts(waypoint, &slns, &self.options);
+        let mut course_points = Vec::new();
+        CourseSetBuilder::add_course_points(
+            &mut course_points,
+            &near_intercepts,
+            waypoint,
+            self.options.strategy,
+        );
+        course_points
+    }
+
+    /// The whole course as edited so far
+    ///
+    /// Finds every waypoint's course points from its matches, which takes no
+    /// geodesic calculations, but is best left until the whole course is
+    /// needed, such as for export.
+    pub fn course(&self) -> Course {
+        let records = self
+            .route_points
+            .iter()
+            .enumerate()
+            .filter(|&(i, point)| i == 0 || self.route_points[i - 1] != *point)
+            .enumerate()
+            .map(|(j, (_, point))| Record {
+                point: *point,
+                cumulative_distance: self.route.cumulative_distance(j),
+            })
+            .collect();
+
+        // Unwrap is safe here because interceptions with NaN distances are
+        // never kept as matches.
+        let mut course_points = (0..self.waypoints.len())
+            .flat_map(|w| self.course_points(w))
+            .collect::<Vec<_>>();
+        course_points.sort_by(|a, b| a.distance.partial_cmp(&b.distance).unwrap());
+
+        Course {
+            records,
+            course_points,
+            name: None,
+        }
+    }
+}
+
 #[derive(Clone, Copy, Debug)]
 struct NearIntercept {
     /// The point of interception.
@@ -480,6 +1065,9 @@ struct NearIntercept {
     /// The distance along the entire course at which this point of interception
     /// appears.
     course_distance: Meter<f64>,
+
+    /// The number of iterations used to solve for the intercept point.
+    iterations: u32,
 }
 
 impl PartialEq for NearIntercept {
@@ -571,32 +1159,57 @@ impl RouteBuilder {
     /// Segments the course
     ///
     /// Does the initial geodesic calculations of solving the indirect problem
-    /// between adjacent points, and lifting points into instances the type
-    /// parameter `P` (such as [`XyzPoint`]).
-    fn segment(&mut self) -> Result<SegmentedCourseBuilder<'_>> {
-        self.xyz_points = iter_work!(self.route_points)
-            .map(|p| GeoAndXyzPoint::try_from(*p))
-            .collect::<std::result::Result<Vec<_>, _>>()?;
-
-        let index_pairs = (0..self.xyz_points.len().saturating_sub(1))
-            .map(|i| (i, i + 1))
-            .collect::<Vec<_>>();
-        let segments = iter_work!(index_pairs)
-            .map(|(i, j)| GeoSegment::from_geo_points(&self.xyz_points[*i], &self.xyz_points[*j]))
-            .collect::<std::result::Result<Vec<_>, _>>()?;
+    /// between adjacent points with `solver`, and lifting points into instances
+    /// the type parameter `P` (such as [`XyzPoint`]).  Waypoints will be
+    /// matched against the segments with a prefilter in `prefilter` precision.
+    /// Segments are solved through `cache`, if given.
+    fn segment(
+        &mut self,
+        solver: GeodesicSolver,
+        prefilter: PrefilterPrecision,
+        cache: Option<&GeodesicCache>,
+    ) -> Result<SegmentedCourseBuilder<'_>> {
+        // Load the route into the native segment store, which lifts its points
+        // to geocentric coordinates and solves the inverse problem along each
+        // segment, and then keeps it for matching waypoints.
+        let route = RouteStore::new(&self.route_points, solver, prefilter, cache)?;
+        self.xyz_points = self
+            .route_points
+            .iter()
+            .enumerate()
+            .map(|(i, geo)| -> Result<GeoAndXyzPoint> {
+                Ok(GeoAndXyzPoint {
+                    geo: *geo,
+                    xyz: route.xyz_point(i)?,
+                })
+            })
+            .collect::<Result<Vec<_>>>()?;
 
-        let segments_and_distances: Vec<(GeoSegment<GeoAndXyzPoint>, Meter<f64>)> = segments
-            .into_iter()
-            .scan(0.0 * M, |dist, s| {
-                let start_dist = *dist;
-                *dist += s.geo_length;
-                Some((s, start_dist))
+        let mut num_by_path = [0usize; 3];
+        let segments_and_distances = (0..route.num_segments())
+            .map(|i| -> Result<(GeoSegment<GeoAndXyzPoint>, Meter<f64>)> {
+                let segment = route.segment(i)?;
+                num_by_path[segment.path as usize] += 1;
+                Ok((
+                    GeoSegment {
+                        start: &self.xyz_points[i],
+                        end: &self.xyz_points[i + 1],
+                        geo_length: segment.length,
+                        start_azimuth: segment.start_azimuth,
+                    },
+                    route.cumulative_distance(i),
+                ))
             })
-            .collect::<Vec<_>>();
+            .collect::<Result<Vec<_>>>()?;
+        debug!(
+            "Solved {} segment(s) with the series solver, {} exact, and {} in the tangent plane",
+            num_by_path[0], num_by_path[1], num_by_path[2]
+        );
 
         Ok(SegmentedCourseBuilder {
             xyz_points: &self.xyz_points,
             segments_and_distances,
+            route,
             name: self.name.clone(),
             course_points: Vec::new(),
             num_repeated_points_skipped: self.num_repeated_points_skipped,
@@ -608,7 +1221,7 @@ impl RouteBuilder {
 ///
 /// This represents an intermediate stage of building a [`Course`]: The initial
 /// work of processing route points into geodesic segments along with computing
-/// distance information and [`XyPoint`] values has been done, but course points
+/// distance information and geocentric points has been done, but course points
 /// have not yet been resolved.
 ///
 /// This builder is used internally within [`CourseSetBuilder`] to process
@@ -616,6 +1229,7 @@ impl RouteBuilder {
 struct SegmentedCourseBuilder<'a> {
     xyz_points: &'a Vec<GeoAndXyzPoint>,
     segments_and_distances: Vec<(GeoSegment<'a, GeoAndXyzPoint>, Meter<f64>)>,
+    route: RouteStore,
     name: Option<String>,
     course_points: Vec<CoursePoint>,
     num_repeated_points_skipped: usize,
@@ -746,15 +1360,22 @@ mod tests {
     use dimensioned::si::{M, Meter};
     use wasm_bindgen_test::wasm_bindgen_test;
 
-    use crate::course::{CourseSetBuilder, InterceptSolution, NearIntercept, RouteBuilder};
+    use crate::course::{
+        Course, CourseDelta, CourseEditor, CoursePoint, CourseSetBuilder, GeodesicSolver,
+        InterceptSolution, InterceptStrategy, NearIntercept, PrefilterPrecision, RouteBuilder,
+    };
     use crate::fit::CoursePointType;
+    use crate::measure::DEG;
+    use crate::pipeline_bench::{resample_track, synthetic_track, synthetic_waypoints};
     use crate::types::GeoPoint;
     use crate::{CourseSetOptions, geo_point, geo_points};
 
     #[test]
     #[wasm_bindgen_test]
     fn test_route_builder_empty() -> Result<()> {
-        let course = RouteBuilder::new().segment()?.build()?;
+        let course = RouteBuilder::new()
+            .segment(GeodesicSolver::Series, PrefilterPrecision::Double, None)?
+            .build()?;
         assert_eq!(course.records, vec![]);
         Ok(())
     }
@@ -765,7 +1386,7 @@ mod tests {
         let mut builder = RouteBuilder::new();
         builder.with_route_point(geo_point!(1.0, 2.0)?);
         let record_points = builder
-            .segment()?
+            .segment(GeodesicSolver::Series, PrefilterPrecision::Double, None)?
             .build()?
             .records
             .iter()
@@ -786,7 +1407,7 @@ mod tests {
             .with_route_point(geo_point!(1.0, 2.0)?)
             .with_route_point(geo_point!(1.1, 2.2)?);
         let record_points = builder
-            .segment()?
+            .segment(GeodesicSolver::Series, PrefilterPrecision::Double, None)?
             .build()?
             .records
             .iter()
@@ -812,7 +1433,9 @@ mod tests {
             .with_route_point(geo_point!(1.1, 2.2)?)
             .with_route_point(geo_point!(1.1, 2.2)?);
 
-        let course = builder.segment()?.build()?;
+        let course = builder
+            .segment(GeodesicSolver::Series, PrefilterPrecision::Double, None)?
+            .build()?;
         let record_points = course.records.iter().map(|r| r.point).collect::<Vec<_>>();
 
         let expected_points = geo_points![(1.0, 2.0), (1.1, 2.2), (1.2, 2.1), (1.1, 2.2)]?;
@@ -912,6 +1535,215 @@ mod tests {
         Ok(())
     }
 
+    // Not a wasm_bindgen_test, since the web build has no cache and only
+    // counts misses.
+    #[test]
+    fn test_geodesic_cache_shared_routes() -> Result<()> {
+        // A route, a copy of it, and the route run in reverse share every
+        // segment, so only the first route's segments need solving.
+        let points = geo_points![
+            (37.25579, -122.19817),
+            (37.25997, -122.18813),
+            (37.26310, -122.17985)
+        ]?;
+        let reversed = points.iter().rev().copied().collect::<Vec<_>>();
+        let mut builder =
+            CourseSetBuilder::new(CourseSetOptions::default().with_geodesic_cache(64));
+        for route in [&points[..], &points[..], &reversed[..]] {
+            let route_builder = builder.add_route();
+            for point in route {
+                route_builder.with_route_point(*point);
+            }
+        }
+
+        let course_set = builder.build()?;
+        let stats = course_set.geodesic_cache_stats.unwrap();
+        assert_eq!(stats.inverse_misses, 2);
+        assert_eq!(stats.inverse_hits, 2);
+        assert_eq!(stats.inverse_reversed_hits, 2);
+
+        let total = |i: usize| {
+            course_set.courses[i]
+                .records
+                .last()
+                .unwrap()
+                .cumulative_distance
+        };
+        assert_eq!(total(1), total(0));
+        assert_relative_eq!(total(2), total(0), epsilon = 0.000_001 * M);
+
+        let uncached = CourseSetBuilder::new(CourseSetOptions::default()).build()?;
+        assert_eq!(uncached.geodesic_cache_stats, None);
+        Ok(())
+    }
+
+    /// Builds a single course from scratch, as [`CourseEditor`] should
+    /// have it
+    fn build_course(
+        options: &CourseSetOptions,
+        route_points: &[GeoPoint],
+        waypoints: &[GeoPoint],
+    ) -> Result<Course> {
+        let mut builder = CourseSetBuilder::new(options.clone());
+        let route = builder.add_route();
+        for point in route_points {
+            route.with_route_point(*point);
+        }
+        for (w, point) in waypoints.iter().enumerate() {
+            builder.add_waypoint(*point, CoursePointType::Generic, format!("{w}"));
+        }
+        Ok(builder.build()?.courses.remove(0))
+    }
+
+    /// Applies an edit's delta to a caller's copy of each waypoint's course
+    /// points, and checks that they agree with `expected`, up to rounding in
+    /// the shifts.
+    fn apply_delta(course_points: &mut [Vec<CoursePoint>], delta: CourseDelta, expected: &Course) {
+        for applied in course_points.iter_mut() {
+            for course_point in applied.iter_mut() {
+                if course_point.distance >= delta.shift_after {
+                    course_point.distance += delta.shift;
+                }
+            }
+        }
+        for (w, points) in delta.changed {
+            course_points[w] = points;
+        }
+
+        let mut applied = course_points.concat();
+        applied.sort_by(|a, b| a.distance.partial_cmp(&b.distance).unwrap());
+        assert_eq!(applied.len(), expected.course_points.len());
+        for (applied, expected) in applied.iter().zip(&expected.course_points) {
+            assert_eq!(applied.name, expected.name);
+            assert_eq!(applied.point, expected.point);
+            assert_relative_eq!(applied.distance, expected.distance, epsilon = 0.000_01 * M);
+        }
+    }
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_course_editor() -> Result<()> {
+        let mut route_points = resample_track(&synthetic_track(50)?, 400)?;
+        let waypoints = synthetic_waypoints(&route_points, 40)?;
+        let options = CourseSetOptions::default()
+            .with_threshold(50.0 * M)
+            .with_strategy(InterceptStrategy::All);
+
+        // A caller's copy of each waypoint's course points, kept up to date
+        // only by applying deltas.
+        let mut editor = CourseEditor::new(options.clone(), route_points.clone())?;
+        let mut course_points = Vec::<Vec<CoursePoint>>::new();
+        for (w, point) in waypoints.iter().enumerate() {
+            let delta = editor.add_waypoint(*point, CoursePointType::Generic, format!("{w}"))?;
+            assert_eq!(delta.shift, 0.0 * M);
+            course_points.extend(delta.changed.into_iter().map(|(_, points)| points));
+        }
+
+        // Nudge the ends, and then move points onto waypoints, which then
+        // become course points if they weren't already.
+        let nudge = |point: &GeoPoint| {
+            GeoPoint::new(
+                point.lat() + 0.0005 * DEG,
+                point.lon() + -0.0005 * DEG,
+                None,
+            )
+        };
+        let moves = [
+            (0, nudge(&route_points[0])?),
+            (399, nudge(&route_points[399])?),
+        ]
+        .into_iter()
+        .chain((0..10).map(|k| (37 * k + 5, waypoints[k])));
+        for (i, point) in moves {
+            let delta = editor.move_route_point(i, point)?;
+            route_points[i] = point;
+
+            // The editor's course should be exactly what a fresh build gives,
+            // and the deltas should agree with it.
+            let course = editor.course();
+            let expected = build_course(&options, &route_points, &waypoints)?;
+            assert_eq!(course.records, expected.records);
+            assert_eq!(course.course_points, expected.course_points);
+            apply_delta(&mut course_points, delta, &expected);
+        }
+        assert!(course_points[..10].iter().all(|points| !points.is_empty()));
+        Ok(())
+    }
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_course_editor_repeated_points() -> Result<()> {
+        // The route starts with a repeated point, which a build drops.
+        let mut route_points = resample_track(&synthetic_track(20)?, 100)?;
+        route_points.insert(21, route_points[20]);
+        let waypoints = synthetic_waypoints(&route_points, 20)?;
+        let options = CourseSetOptions::default()
+            .with_threshold(50.0 * M)
+            .with_strategy(InterceptStrategy::All);
+
+        let mut editor = CourseEditor::new(options.clone(), route_points.clone())?;
+        let mut course_points = Vec::<Vec<CoursePoint>>::new();
+        for (w, point) in waypoints.iter().enumerate() {
+            let delta = editor.add_waypoint(*point, CoursePointType::Generic, format!("{w}"))?;
+            course_points.extend(delta.changed.into_iter().map(|(_, points)| points));
+        }
+        assert_eq!(
+            editor.course().records,
+            build_course(&options, &route_points, &waypoints)?.records
+        );
+
+        // Land points on the neighbours before and after them, and move them
+        // and the starting repeat off again.  In between, move points past the
+        // repeats, which the loaded route numbers differently.
+        let moves = [
+            (31, route_points[30]),
+            (60, waypoints[5]),
+            (40, route_points[41]),
+            (90, waypoints[9]),
+            (31, waypoints[3]),
+            (21, waypoints[1]),
+            (40, waypoints[7]),
+            (70, waypoints[11]),
+        ];
+        for (i, point) in moves {
+            let delta = editor.move_route_point(i, point)?;
+            route_points[i] = point;
+            assert_eq!(editor.route_points(), &route_points[..]);
+
+            let course = editor.course();
+            let expected = build_course(&options, &route_points, &waypoints)?;
+            assert_eq!(course.records, expected.records);
+            assert_eq!(course.course_points, expected.course_points);
+            apply_delta(&mut course_points, delta, &expected);
+        }
+        Ok(())
+    }
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_course_editor_failed_move() -> Result<()> {
+        let route_points = resample_track(&synthetic_track(10)?, 100)?;
+        let waypoints = synthetic_waypoints(&route_points, 10)?;
+        let options = CourseSetOptions::default().with_threshold(50.0 * M);
+        let mut editor = CourseEditor::new(options, route_points.clone())?;
+        for (w, point) in waypoints.iter().enumerate() {
+            editor.add_waypoint(*point, CoursePointType::Generic, format!("{w}"))?;
+        }
+        let before = editor.course();
+        assert!(editor.route.is_indexed());
+
+        // A point that can't be converted fails the move, which is rolled back,
+        // and the route should be indexed again afterwards.
+        let unconvertible = GeoPoint::new(f64::NAN * DEG, route_points[40].lon(), None)?;
+        assert!(editor.move_route_point(40, unconvertible).is_err());
+        assert!(editor.route.is_indexed());
+        assert_eq!(editor.route_points(), &route_points[..]);
+        let after = editor.course();
+        assert_eq!(after.records, before.records);
+        assert_eq!(after.course_points, before.course_points);
+        Ok(())
+    }
+
     #[test]
     #[wasm_bindgen_test]
     fn test_intercept_distance_ordering() {
@@ -920,6 +1752,7 @@ mod tests {
                 intercept_point: GeoPoint::default(),
                 intercept_distance: distance,
                 course_distance: 0.0 * M,
+                iterations: 0,
             }
         }
 
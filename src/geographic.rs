@@ -2,11 +2,17 @@
 //!
 //! Wraps the CXX FFI for GeographicLib in a friendlier interface.
 
-use dimensioned::si::Meter;
+use dimensioned::si::{M, Meter};
 use thiserror::Error;
 pub use wrappers::{
-    compiler_version_str, geocentric_forward, geodesic_direct, geodesic_inverse,
-    geographiclib_version_str, gnomonic_forward, gnomonic_reverse,
+    GeodesicCache, RouteSegmenter, RouteStore, compiler_version_str, geocentric_forward,
+    geodesic_direct, geodesic_intercept, geodesic_inverse, geographiclib_version_str,
+    match_waypoints, match_waypoints_in_segments, shim_cpu_features_str, shim_stats_enable,
+    shim_stats_reset, shim_stats_snapshot,
+};
+#[cfg(test)]
+pub use wrappers::{
+    geocentric_forward_batch, geodesic_inverse_with_solver, geodesic_polyline_inverse,
 };
 
 use crate::measure::Degree;
@@ -21,6 +27,8 @@ pub enum GeographicError {
     Type(#[from] TypeError),
     #[error("JSON deserialization")]
     Json(String),
+    #[error("GeographicLib module heap: {0}")]
+    ModuleHeap(String),
 }
 
 type Result<T> = std::result::Result<T, GeographicError>;
@@ -51,15 +59,346 @@ pub struct InverseSolution {
     pub azimuth2: Degree<f64>,
 }
 
+/// A solution to the interception problem between a geodesic segment and a
+/// point.
+#[derive(Clone, Copy)]
+pub struct Interception {
+    /// The point on the segment nearest the other point.
+    pub point: GeoPoint,
+
+    /// Geodesic distance between the interception point and the other point.
+    pub distance: Meter<f64>,
+
+    /// Geodesic distance along the segment from its start to the
+    /// interception point.
+    pub offset: Meter<f64>,
+
+    /// The number of gnomonic iterations used to find the point.
+    pub iterations: u32,
+}
+
+/// Convergence criteria for solving the interception problem
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub struct InterceptOptions {
+    /// Iteration stops once the intercept moves no more than this distance.
+    pub tolerance: Meter<f64>,
+
+    /// The maximum number of iterations to perform.
+    pub max_iterations: u32,
+}
+
+impl InterceptOptions {
+    /// Options that always perform exactly `iterations` iterations.
+    pub fn fixed(iterations: u32) -> Self {
+        Self {
+            tolerance: -1.0 * M,
+            max_iterations: iterations,
+        }
+    }
+}
+
+impl Default for InterceptOptions {
+    /// Converges to within a millimeter, using at most the 10 iterations
+    /// Karney suggested in his example solution to the interception problem.
+    fn default() -> Self {
+        Self {
+            tolerance: 0.001 * M,
+            max_iterations: 10,
+        }
+    }
+}
+
+/// A policy for choosing how to solve the inverse geodesic problem
+#[cfg_attr(feature = "cli", derive(clap::ValueEnum, strum::Display))]
+#[derive(Clone, Copy, PartialEq, Eq, Debug, Default)]
+#[cfg_attr(feature = "cli", strum(serialize_all = "kebab-case"))]
+#[cfg_attr(feature = "cli", clap(rename_all = "kebab-case"))]
+#[repr(C)]
+pub enum GeodesicSolver {
+    /// GeographicLib's series solution, accurate to within nanometers on the
+    /// Earth's ellipsoid.
+    #[default]
+    Series = 0,
+
+    /// GeographicLib's solution in terms of elliptic integrals, which is
+    /// slower, but remains accurate for any flattening.
+    Exact = 1,
+
+    /// A tangent plane approximation for segments up to a kilometer long away
+    /// from the poles, which agrees with the series solution to within a tenth
+    /// of a millimeter, and the series solution for everything else.
+    Auto = 2,
+}
+
+/// The precision in which a [`RouteStore`] filters its segments by their
+/// distance floors before solving interceptions
+#[cfg_attr(feature = "cli", derive(clap::ValueEnum, strum::Display))]
+#[derive(Clone, Copy, PartialEq, Eq, Debug, Default)]
+#[cfg_attr(feature = "cli", strum(serialize_all = "kebab-case"))]
+#[cfg_attr(feature = "cli", clap(rename_all = "kebab-case"))]
+#[repr(C)]
+pub enum PrefilterPrecision {
+    /// Double precision, on the route's geocentric coordinates.
+    #[default]
+    Double = 0,
+
+    /// Single precision, on coordinates relative to the route's center, which
+    /// filters long routes nearly twice as fast.  The floors are widened by a
+    /// bound on their rounding error, so the matches found are the same.
+    Single = 1,
+}
+
+/// The solver that a [`GeodesicSolver`] policy chose for a segment
+///
+/// Only ever constructed by the shim, as `geodesic_path`.
+#[allow(dead_code)]
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+#[repr(C)]
+pub enum GeodesicPath {
+    Series = 0,
+    Exact = 1,
+    TangentPlane = 2,
+}
+
+/// Counts of the lookups a [`GeodesicCache`] has served.
+///
+/// Each lookup is exactly one hit, answered from a remembered solution of the
+/// same problem or of its reverse, or one miss, which was solved.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+#[repr(C)]
+pub struct GeodesicCacheStats {
+    /// Inverse problems answered from a remembered solution.
+    pub inverse_hits: u64,
+
+    /// Inverse problems answered from the remembered solution of their
+    /// reverse.
+    pub inverse_reversed_hits: u64,
+
+    /// Inverse problems that were solved.
+    pub inverse_misses: u64,
+
+    /// Direct problems answered from a remembered solution.
+    pub direct_hits: u64,
+
+    /// Direct problems that were solved.
+    pub direct_misses: u64,
+}
+
+impl GeodesicCacheStats {
+    /// The fraction of inverse lookups that were hits, either way round, or
+    /// NaN if there were none.
+    pub fn inverse_hit_rate(&self) -> f64 {
+        let hits = self.inverse_hits + self.inverse_reversed_hits;
+        hits as f64 / (hits + self.inverse_misses) as f64
+    }
+
+    /// The fraction of direct lookups that were hits, or NaN if there were
+    /// none.
+    pub fn direct_hit_rate(&self) -> f64 {
+        self.direct_hits as f64 / (self.direct_hits + self.direct_misses) as f64
+    }
+}
+
+/// The number of buckets in each of the shim's latency histograms.
+pub const SHIM_STATS_BUCKETS: usize = 32;
+
+/// The names of the shim's instrumented entry points, in the order of its
+/// `shim_stats_probe` enum.
+pub const SHIM_PROBES: [&str; 13] = [
+    "inverse",
+    "direct",
+    "polyline_inverse",
+    "geocentric_batch",
+    "intercept",
+    "match_waypoints",
+    "route_store_load",
+    "route_store_finish",
+    "segmenter_push",
+    "cache_inverse",
+    "cache_direct",
+    "intercept_n",
+    "route_store_move_point",
+];
+
+/// What one of the shim's probes has recorded.
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+#[repr(C)]
+pub struct ProbeStats {
+    /// Calls made to the entry point.
+    pub calls: u64,
+
+    /// The calls' total duration in nanoseconds, including any time spent in
+    /// other probes they called.
+    pub nanoseconds: u64,
+
+    /// Bucket `k` counts the calls that took at least 2^k and less than
+    /// 2^(k+1) nanoseconds, except that the first also counts calls that took
+    /// no measurable time and the last every call longer than it.
+    pub histogram: [u64; SHIM_STATS_BUCKETS],
+}
+
+impl ProbeStats {
+    /// The calls' mean duration in nanoseconds, or NaN if there were none.
+    pub fn mean_nanoseconds(&self) -> f64 {
+        self.nanoseconds as f64 / self.calls as f64
+    }
+
+    /// An upper bound in nanoseconds on the duration of the fraction `q` of
+    /// calls that were fastest, read off the histogram, or `None` if there were
+    /// no calls.
+    ///
+    /// The bound is the upper edge of the histogram bucket in which the
+    /// quantile falls, so it may be up to twice the true quantile.
+    pub fn quantile_nanoseconds(&self, q: f64) -> Option<u64> {
+        let total = self.histogram.iter().sum::<u64>();
+        if total == 0 {
+            return None;
+        }
+        let rank = ((q * total as f64).ceil() as u64).clamp(1, total);
+        let mut seen = 0;
+        for (k, count) in self.histogram.iter().enumerate() {
+            seen += count;
+            if seen >= rank {
+                return Some(2u64 << k);
+            }
+        }
+        unreachable!()
+    }
+}
+
+/// What every one of the shim's probes has recorded, as returned by
+/// [`shim_stats_snapshot`].
+#[derive(Clone, Copy, Debug, Default, PartialEq, Eq)]
+#[repr(C)]
+pub struct ShimStats {
+    /// Each probe's stats, in the order of [`SHIM_PROBES`].
+    pub probes: [ProbeStats; SHIM_PROBES.len()],
+}
+
+impl ShimStats {
+    /// Iterates over the probes that recorded any calls, with their names.
+    pub fn iter(&self) -> impl Iterator<Item = (&'static str, &ProbeStats)> {
+        SHIM_PROBES
+            .iter()
+            .copied()
+            .zip(self.probes.iter())
+            .filter(|(_, probe)| probe.calls > 0)
+    }
+}
+
+/// A segment of a route loaded into a [`RouteStore`].
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub struct RouteSegment {
+    /// Azimuth of the segment's geodesic at its start.
+    pub start_azimuth: Degree<f64>,
+
+    /// Geodesic length of the segment.
+    pub length: Meter<f64>,
+
+    /// The solver the segment was solved with.
+    pub path: GeodesicPath,
+}
+
+/// A route point emitted by a [`RouteSegmenter`], with the segment leaving it.
+#[derive(Clone, Copy, Debug, PartialEq)]
+pub struct SegmentRecord {
+    /// The route point.
+    pub point: GeoPoint,
+
+    /// The point's geocentric coordinates, unless they couldn't be computed.
+    pub xyz_point: Option<XyzPoint>,
+
+    /// The segment joining the point to the next one, unless it couldn't be
+    /// solved or this is the route's last point.
+    pub segment: Option<RouteSegment>,
+
+    /// The point's geodesic distance along the route from its first point.
+    /// NaN after any segment that failed.
+    pub cumulative_distance: Meter<f64>,
+}
+
+/// A route segment passing near a waypoint, as found by [`match_waypoints`].
+pub struct WaypointMatch {
+    /// The index of the waypoint.
+    pub waypoint: usize,
+
+    /// The index of the segment within the route.
+    pub segment: usize,
+
+    /// The waypoint's interception with the segment.
+    pub interception: Result<Interception>,
+}
+
+/// Solutions to the inverse problem between adjacent points of a polyline.
+#[cfg(any(test, feature = "jsffi"))]
+pub struct PolylineSolution {
+    /// Solutions for each segment, where element `i` joins point `i` to
+    /// point `i + 1`.
+    pub segments: Vec<Result<InverseSolution>>,
+
+    /// Each point's geodesic distance along the polyline from its first
+    /// point.  Becomes NaN after any segment that failed.
+    pub cumulative_distances: Vec<Meter<f64>>,
+}
+
+/// Waypoints laid out for [`match_waypoints_in_segments`], one column per
+/// coordinate, so that matching the same waypoints again doesn't gather their
+/// coordinates each time.
+#[derive(Clone, Debug, Default)]
+pub struct WaypointColumns {
+    lat: Vec<f64>,
+    lon: Vec<f64>,
+    x: Vec<f64>,
+    y: Vec<f64>,
+    z: Vec<f64>,
+}
+
+impl WaypointColumns {
+    /// The number of waypoints.
+    pub fn len(&self) -> usize {
+        self.lat.len()
+    }
+
+    /// Adds a waypoint after the others.
+    pub fn push(&mut self, point: &GeoAndXyzPoint) {
+        self.lat.push(point.geo.lat().value_unsafe);
+        self.lon.push(point.geo.lon().value_unsafe);
+        self.x.push(point.xyz.x.value_unsafe);
+        self.y.push(point.xyz.y.value_unsafe);
+        self.z.push(point.xyz.z.value_unsafe);
+    }
+}
+
+impl From<&[GeoAndXyzPoint]> for WaypointColumns {
+    fn from(points: &[GeoAndXyzPoint]) -> Self {
+        let mut columns = Self::default();
+        for point in points {
+            columns.push(point);
+        }
+        columns
+    }
+}
+
 #[cfg(not(feature = "jsffi"))]
 mod wrappers {
     use std::ffi::CStr;
+    use std::ops::Range;
 
     use dimensioned::si::{M, Meter};
+    #[cfg(feature = "rayon")]
+    use rayon::prelude::*;
 
-    use crate::geographic::wrappers::ffi::{compiler_version, geographiclib_version};
-    use crate::geographic::{DirectSolution, GeographicError, InverseSolution, Result};
-    use crate::types::{XyPoint, XyzPoint};
+    #[cfg(test)]
+    use crate::geographic::PolylineSolution;
+    use crate::geographic::wrappers::ffi::{
+        compiler_version, geographiclib_version, shim_cpu_features,
+    };
+    use crate::geographic::{
+        DirectSolution, GeodesicCacheStats, GeodesicPath, GeodesicSolver, GeographicError,
+        InterceptOptions, Interception, InverseSolution, PrefilterPrecision, Result, RouteSegment,
+        SegmentRecord, ShimStats, WaypointColumns, WaypointMatch,
+    };
+    use crate::types::{GeoAndXyzPoint, XyzPoint};
     use crate::{DEG, Degree, GeoPoint};
 
     /// Calculate a solution to the direct geodesic problem.
@@ -130,57 +469,685 @@ mod wrappers {
         }
     }
 
-    /// Calculate the forward gnomonic projection of a point.
+    /// Calculate a solution to the inverse geodesic problem with the solver
+    /// chosen by a [`GeodesicSolver`] policy.
     ///
-    /// Given a projection centerpoint `point0` and a point `point`, finds the
-    /// cartesian position of `point` in the gnomonic projection centered on
-    /// `point0`.
-    pub fn gnomonic_forward(point0: &GeoPoint, point: &GeoPoint) -> Result<XyPoint> {
-        let mut result = XyPoint::default();
+    /// Like [`geodesic_inverse`], but also returns the solver that was used.
+    /// A tangent plane solution's arc distance is only approximate.  Only
+    /// tests need to solve segments one at a time; routes are solved as
+    /// they're loaded into a [`RouteStore`].
+    #[cfg(test)]
+    pub fn geodesic_inverse_with_solver(
+        point1: &GeoPoint,
+        point2: &GeoPoint,
+        solver: GeodesicSolver,
+    ) -> Result<(InverseSolution, GeodesicPath)> {
+        let mut geo_distance_m = 0.0;
+        let mut azimuth1_deg = 0.0;
+        let mut azimuth2_deg = 0.0;
+        let mut arc_distance_deg = 0.0;
+        let mut path = GeodesicPath::Series;
         let ok = unsafe {
-            ffi::gnomonic_forward(
-                point0.lat().value_unsafe,
-                point0.lon().value_unsafe,
-                point.lat().value_unsafe,
-                point.lon().value_unsafe,
-                &mut result.x.value_unsafe,
-                &mut result.y.value_unsafe,
+            ffi::geo_context_inverse_with_solver(
+                ffi::geo_context_wgs84(),
+                solver,
+                point1.lat().value_unsafe,
+                point1.lon().value_unsafe,
+                point2.lat().value_unsafe,
+                point2.lon().value_unsafe,
+                &mut geo_distance_m,
+                &mut azimuth1_deg,
+                &mut azimuth2_deg,
+                &mut arc_distance_deg,
+                &mut path,
             )
         };
 
         if ok {
-            Ok(result)
+            Ok((
+                InverseSolution {
+                    arc_distance: arc_distance_deg * DEG,
+                    geo_distance: geo_distance_m * M,
+                    azimuth1: azimuth1_deg * DEG,
+                    azimuth2: azimuth2_deg * DEG,
+                },
+                path,
+            ))
         } else {
             Err(GeographicError::UnknownException)
         }
     }
 
-    /// Calculate the reverse gnomonic projection of a point.
+    /// Calculate solutions to the inverse geodesic problem along a polyline.
     ///
-    /// Given a projection centerpoint `point0` and a projected (cartesian)
-    /// point `xypoint`, finds the latitude and longitude corresponding to
-    /// `xypoint` given the gnomonic projection centered on `point0`.
-    pub fn gnomonic_reverse(point0: &GeoPoint, xypoint: &XyPoint) -> Result<GeoPoint> {
+    /// Solves every segment between adjacent `points`, along with the
+    /// cumulative distance at each point, in a single FFI call.  Native routes
+    /// are solved as they're loaded into a [`RouteStore`], so only tests call
+    /// this; the web segmenter calls the shim's polyline solver directly.
+    #[cfg(test)]
+    pub fn geodesic_polyline_inverse(points: &[GeoPoint]) -> PolylineSolution {
+        let n = points.len();
+        let num_segments = n.saturating_sub(1);
+        let latlon = points
+            .iter()
+            .flat_map(|p| [p.lat().value_unsafe, p.lon().value_unsafe])
+            .collect::<Vec<_>>();
+        let mut s12 = vec![0.0; num_segments];
+        let mut azi1 = vec![0.0; num_segments];
+        let mut azi2 = vec![0.0; num_segments];
+        let mut a12 = vec![0.0; num_segments];
+        let mut cumulative = vec![0.0; n];
+        let mut ok = vec![false; num_segments];
+        unsafe {
+            ffi::geodesic_polyline_inverse(
+                latlon.as_ptr(),
+                n,
+                s12.as_mut_ptr(),
+                azi1.as_mut_ptr(),
+                azi2.as_mut_ptr(),
+                a12.as_mut_ptr(),
+                cumulative.as_mut_ptr(),
+                ok.as_mut_ptr(),
+            );
+        }
+
+        PolylineSolution {
+            segments: (0..num_segments)
+                .map(|i| {
+                    if ok[i] {
+                        Ok(InverseSolution {
+                            arc_distance: a12[i] * DEG,
+                            geo_distance: s12[i] * M,
+                            azimuth1: azi1[i] * DEG,
+                            azimuth2: azi2[i] * DEG,
+                        })
+                    } else {
+                        Err(GeographicError::UnknownException)
+                    }
+                })
+                .collect(),
+            cumulative_distances: cumulative.into_iter().map(|d| d * M).collect(),
+        }
+    }
+
+    /// Splits points into parallel arrays of latitudes and longitudes
+    fn split_lat_lon(points: &[GeoPoint]) -> (Vec<f64>, Vec<f64>) {
+        points
+            .iter()
+            .map(|p| (p.lat().value_unsafe, p.lon().value_unsafe))
+            .unzip()
+    }
+
+    /// Solve the interception problem between a geodesic segment and a point.
+    ///
+    /// The segment runs from `start` to `end`, with the given azimuth at its
+    /// start and geodesic length.  The iterative solution runs entirely in
+    /// C++; see [`crate::algorithm::karney_interception`] for a description.
+    pub fn geodesic_intercept(
+        start: &GeoPoint,
+        end: &GeoPoint,
+        start_azimuth: Degree<f64>,
+        length: Meter<f64>,
+        point: &GeoPoint,
+        options: &InterceptOptions,
+    ) -> Result<Interception> {
         let mut lat_deg = 0.0;
         let mut lon_deg = 0.0;
+        let mut distance_m = 0.0;
+        let mut offset_m = 0.0;
+        let mut iterations = 0;
         let ok = unsafe {
-            ffi::gnomonic_reverse(
-                point0.lat().value_unsafe,
-                point0.lon().value_unsafe,
-                xypoint.x.value_unsafe,
-                xypoint.y.value_unsafe,
+            ffi::geodesic_intercept(
+                start.lat().value_unsafe,
+                start.lon().value_unsafe,
+                end.lat().value_unsafe,
+                end.lon().value_unsafe,
+                start_azimuth.value_unsafe,
+                length.value_unsafe,
+                point.lat().value_unsafe,
+                point.lon().value_unsafe,
+                options.tolerance.value_unsafe,
+                options.max_iterations,
                 &mut lat_deg,
                 &mut lon_deg,
+                &mut distance_m,
+                &mut offset_m,
+                &mut iterations,
             )
         };
 
         if ok {
-            Ok(GeoPoint::new(lat_deg * DEG, lon_deg * DEG, None)?)
+            Ok(Interception {
+                point: GeoPoint::new(lat_deg * DEG, lon_deg * DEG, None)?,
+                distance: distance_m * M,
+                offset: offset_m * M,
+                iterations,
+            })
         } else {
             Err(GeographicError::UnknownException)
         }
     }
 
+    /// A bounded memo of geodesic solutions in the shim.
+    ///
+    /// Remembers recent solutions to the inverse and direct problems, keyed
+    /// on their exact inputs, and answers the reverse of a remembered inverse
+    /// problem by swapping its azimuths.  Sharing one between the routes of a
+    /// course set spares solving the segments they have in common again.
+    pub struct GeodesicCache {
+        cache: *mut ffi::GeodesicCache,
+    }
+
+    // SAFETY: The shim locks the cache's slots, and its counters are atomic.
+    unsafe impl Send for GeodesicCache {}
+    unsafe impl Sync for GeodesicCache {}
+
+    impl GeodesicCache {
+        /// Create a cache with room for at least `capacity` solutions of each
+        /// problem, which must be nonzero.
+        pub fn new(capacity: usize) -> Result<Self> {
+            let cache =
+                unsafe { ffi::geo_context_geodesic_cache_new(ffi::geo_context_wgs84(), capacity) };
+            if cache.is_null() {
+                Err(GeographicError::UnknownException)
+            } else {
+                Ok(Self { cache })
+            }
+        }
+
+        /// Solve the inverse problem with the solver chosen by a
+        /// [`GeodesicSolver`] policy, unless the cache remembers its solution.
+        pub fn inverse(
+            &self,
+            point1: &GeoPoint,
+            point2: &GeoPoint,
+            solver: GeodesicSolver,
+        ) -> Result<(InverseSolution, GeodesicPath)> {
+            let mut geo_distance_m = 0.0;
+            let mut azimuth1_deg = 0.0;
+            let mut azimuth2_deg = 0.0;
+            let mut arc_distance_deg = 0.0;
+            let mut path = GeodesicPath::Series;
+            let ok = unsafe {
+                ffi::geodesic_cache_inverse(
+                    self.cache,
+                    solver,
+                    point1.lat().value_unsafe,
+                    point1.lon().value_unsafe,
+                    point2.lat().value_unsafe,
+                    point2.lon().value_unsafe,
+                    &mut geo_distance_m,
+                    &mut azimuth1_deg,
+                    &mut azimuth2_deg,
+                    &mut arc_distance_deg,
+                    &mut path,
+                )
+            };
+
+            if ok {
+                Ok((
+                    InverseSolution {
+                        arc_distance: arc_distance_deg * DEG,
+                        geo_distance: geo_distance_m * M,
+                        azimuth1: azimuth1_deg * DEG,
+                        azimuth2: azimuth2_deg * DEG,
+                    },
+                    path,
+                ))
+            } else {
+                Err(GeographicError::UnknownException)
+            }
+        }
+
+        /// Solve the direct problem as [`geodesic_direct`] does, unless the
+        /// cache remembers its solution.
+        pub fn direct(
+            &self,
+            point1: &GeoPoint,
+            azimuth: Degree<f64>,
+            distance: Meter<f64>,
+        ) -> Result<DirectSolution> {
+            let mut lat2_deg = 0.0;
+            let mut lon2_deg = 0.0;
+            let mut arc_distance_deg = 0.0;
+            let ok = unsafe {
+                ffi::geodesic_cache_direct(
+                    self.cache,
+                    point1.lat().value_unsafe,
+                    point1.lon().value_unsafe,
+                    azimuth.value_unsafe,
+                    distance.value_unsafe,
+                    &mut lat2_deg,
+                    &mut lon2_deg,
+                    &mut arc_distance_deg,
+                )
+            };
+
+            if ok {
+                Ok(DirectSolution {
+                    arc_distance: arc_distance_deg * DEG,
+                    point2: GeoPoint::new(lat2_deg * DEG, lon2_deg * DEG, None)?,
+                })
+            } else {
+                Err(GeographicError::UnknownException)
+            }
+        }
+
+        /// The counts of lookups served so far.
+        pub fn stats(&self) -> GeodesicCacheStats {
+            let mut stats = GeodesicCacheStats::default();
+            unsafe { ffi::geodesic_cache_get_stats(self.cache, &mut stats) };
+            stats
+        }
+    }
+
+    impl Drop for GeodesicCache {
+        fn drop(&mut self) {
+            unsafe { ffi::geodesic_cache_free(self.cache) }
+        }
+    }
+
+    /// The number of route points loaded into a [`RouteStore`] per FFI call
+    const ROUTE_LOAD_CHUNK_SIZE: usize = 1024;
+
+    /// A route loaded into the shim's native segment store.
+    ///
+    /// The route's points, their geocentric coordinates, and its segments'
+    /// azimuths, lengths, and cumulative distances live in one native arena
+    /// alongside the segment index.  The route crosses the FFI boundary once,
+    /// and matching then works on it by handle.
+    pub struct RouteStore {
+        store: *mut ffi::RouteStore,
+        view: ffi::RouteView,
+    }
+
+    // SAFETY: The store is only written while loading, in disjoint ranges,
+    // and afterwards only through `&mut self`.
+    unsafe impl Send for RouteStore {}
+    unsafe impl Sync for RouteStore {}
+
+    impl RouteStore {
+        /// Load a route, converting its points to geocentric coordinates and
+        /// solving the inverse problem along each segment with `solver`, a
+        /// chunk at a time, to be filtered for matching in `precision`.
+        ///
+        /// Segments are solved through `cache`, if given, which is only used
+        /// while loading.
+        pub fn new(
+            points: &[GeoPoint],
+            solver: GeodesicSolver,
+            precision: PrefilterPrecision,
+            cache: Option<&GeodesicCache>,
+        ) -> Result<Self> {
+            let n = points.len();
+            let (lat, lon) = split_lat_lon(points);
+            let cache = cache.map_or(std::ptr::null_mut(), |c| c.cache);
+            let store = unsafe {
+                ffi::geo_context_route_store_new(
+                    ffi::geo_context_wgs84(),
+                    solver,
+                    precision,
+                    cache,
+                    n,
+                )
+            };
+            if store.is_null() {
+                return Err(GeographicError::UnknownException);
+            }
+            let mut route = Self {
+                store,
+                view: ffi::RouteView::default(),
+            };
+            unsafe { ffi::route_store_view(route.store, &mut route.view) };
+
+            let starts = (0..n).step_by(ROUTE_LOAD_CHUNK_SIZE).collect::<Vec<_>>();
+            let load = |start: &usize| route.load(&lat, &lon, *start);
+            #[cfg(feature = "rayon")]
+            starts.par_iter().for_each(load);
+            #[cfg(not(feature = "rayon"))]
+            starts.iter().for_each(load);
+
+            unsafe { ffi::route_store_finish(route.store) };
+            Ok(route)
+        }
+
+        /// Load the chunk of points starting at `start`, given the whole
+        /// route's latitudes and longitudes.
+        ///
+        /// Only called from [`Self::new`], for disjoint chunks, as the store
+        /// requires.
+        fn load(&self, lat: &[f64], lon: &[f64], start: usize) {
+            let count = ROUTE_LOAD_CHUNK_SIZE.min(lat.len() - start);
+            unsafe {
+                ffi::route_store_load(self.store, lat.as_ptr(), lon.as_ptr(), start, count);
+            }
+        }
+
+        /// The number of points in the route.
+        pub fn num_points(&self) -> usize {
+            self.view.n_points
+        }
+
+        /// The number of segments in the route.
+        pub fn num_segments(&self) -> usize {
+            self.view.n_points.saturating_sub(1)
+        }
+
+        /// Whether matching finds the route's segments through its index,
+        /// rather than scanning them all.
+        pub fn is_indexed(&self) -> bool {
+            unsafe { ffi::route_store_indexed(self.store) }
+        }
+
+        fn point_column<T>(&self, column: *const T) -> &[T] {
+            unsafe { std::slice::from_raw_parts(column, self.num_points()) }
+        }
+
+        fn segment_column<T>(&self, column: *const T) -> &[T] {
+            unsafe { std::slice::from_raw_parts(column, self.num_segments()) }
+        }
+
+        /// The geocentric coordinates of point `i`.
+        pub fn xyz_point(&self, i: usize) -> Result<XyzPoint> {
+            if self.point_column(self.view.point_ok)[i] {
+                Ok(XyzPoint {
+                    x: self.point_column(self.view.x)[i] * M,
+                    y: self.point_column(self.view.y)[i] * M,
+                    z: self.point_column(self.view.z)[i] * M,
+                })
+            } else {
+                Err(GeographicError::UnknownException)
+            }
+        }
+
+        /// Segment `i`, which joins point `i` to point `i + 1`.
+        pub fn segment(&self, i: usize) -> Result<RouteSegment> {
+            if self.segment_column(self.view.segment_ok)[i] {
+                Ok(RouteSegment {
+                    start_azimuth: self.segment_column(self.view.azi1)[i] * DEG,
+                    length: self.segment_column(self.view.s12)[i] * M,
+                    path: self.segment_column(self.view.path)[i],
+                })
+            } else {
+                Err(GeographicError::UnknownException)
+            }
+        }
+
+        /// Point `i`'s geodesic distance along the route from its first
+        /// point.  NaN after any segment that failed.
+        pub fn cumulative_distance(&self, i: usize) -> Meter<f64> {
+            self.point_column(self.view.cumulative)[i] * M
+        }
+
+        /// Move point `i` to `point`, re-solving only the segments on either
+        /// side of it and refitting the index around them.  Only the
+        /// cumulative distances after it take time linear in the route.
+        ///
+        /// Every double precision column and cumulative distance afterwards
+        /// is as it would be had the route been loaded with the point already
+        /// moved, except that the cache given to [`Self::new`], if any, isn't
+        /// used.  The single precision coordinates keep the origin loading
+        /// chose, only widening their extent, so they and [`Self::is_indexed`]
+        /// can differ from a fresh load's.  Returns an error if the
+        /// point or either of its segments failed, which is recorded in the
+        /// store just as a failure while loading would be.
+        ///
+        /// # Panics
+        ///
+        /// If `i` is out of range.
+        pub fn move_point(&mut self, i: usize, point: &GeoPoint) -> Result<()> {
+            assert!(i < self.num_points());
+            let ok = unsafe {
+                ffi::route_store_move_point(
+                    self.store,
+                    i,
+                    point.lat().value_unsafe,
+                    point.lon().value_unsafe,
+                )
+            };
+            if ok {
+                Ok(())
+            } else {
+                Err(GeographicError::UnknownException)
+            }
+        }
+    }
+
+    impl Drop for RouteStore {
+        fn drop(&mut self) {
+            unsafe { ffi::route_store_free(self.store) }
+        }
+    }
+
+    /// A streaming geodesic segmenter, for routes too long to load whole.
+    ///
+    /// Points are pushed a chunk at a time, and each point's record is
+    /// emitted as soon as the segment leaving it is known.  Only the trailing
+    /// point is kept between pushes, so memory use doesn't grow with the
+    /// route's length.
+    pub struct RouteSegmenter {
+        segmenter: *mut ffi::RouteSegmenter,
+        pending: Option<GeoPoint>,
+    }
+
+    // SAFETY: The segmenter is only used through `&mut self`.
+    unsafe impl Send for RouteSegmenter {}
+
+    impl RouteSegmenter {
+        /// Start segmenting a route, solving its segments with `solver`.
+        pub fn new(solver: GeodesicSolver) -> Result<Self> {
+            let segmenter =
+                unsafe { ffi::geo_context_route_segmenter_new(ffi::geo_context_wgs84(), solver) };
+            if segmenter.is_null() {
+                return Err(GeographicError::UnknownException);
+            }
+            Ok(Self {
+                segmenter,
+                pending: None,
+            })
+        }
+
+        /// Push the route's next points, appending the records they complete
+        /// to `records`.
+        ///
+        /// The last point is kept pending until the next push or flush, so a
+        /// push emits records for the previously pending point, if any,
+        /// followed by every new point but the last.
+        pub fn push(&mut self, points: &[GeoPoint], records: &mut Vec<SegmentRecord>) {
+            let n = points.len();
+            let (lat, lon) = split_lat_lon(points);
+            let (mut x, mut y, mut z) = (vec![0.0; n], vec![0.0; n], vec![0.0; n]);
+            let mut cumulative = vec![0.0; n];
+            let (mut azi1, mut s12) = (vec![0.0; n], vec![0.0; n]);
+            let mut path = vec![GeodesicPath::Series; n];
+            let (mut point_ok, mut segment_ok) = (vec![false; n], vec![false; n]);
+            let m = unsafe {
+                ffi::route_segmenter_push(
+                    self.segmenter,
+                    lat.as_ptr(),
+                    lon.as_ptr(),
+                    n,
+                    x.as_mut_ptr(),
+                    y.as_mut_ptr(),
+                    z.as_mut_ptr(),
+                    cumulative.as_mut_ptr(),
+                    azi1.as_mut_ptr(),
+                    s12.as_mut_ptr(),
+                    path.as_mut_ptr(),
+                    point_ok.as_mut_ptr(),
+                    segment_ok.as_mut_ptr(),
+                )
+            };
+
+            let emitted = self
+                .pending
+                .iter()
+                .chain(points[..n.saturating_sub(1)].iter());
+            records.extend(emitted.take(m).enumerate().map(|(r, point)| SegmentRecord {
+                point: *point,
+                xyz_point: point_ok[r].then(|| XyzPoint {
+                    x: x[r] * M,
+                    y: y[r] * M,
+                    z: z[r] * M,
+                }),
+                segment: segment_ok[r].then(|| RouteSegment {
+                    start_azimuth: azi1[r] * DEG,
+                    length: s12[r] * M,
+                    path: path[r],
+                }),
+                cumulative_distance: cumulative[r] * M,
+            }));
+            if let Some(last) = points.last() {
+                self.pending = Some(*last);
+            }
+        }
+
+        /// End the route, returning its last point's record, and start a new
+        /// one.
+        pub fn flush(&mut self) -> Option<SegmentRecord> {
+            let point = self.pending.take()?;
+            let (mut x, mut y, mut z) = (0.0, 0.0, 0.0);
+            let mut cumulative = 0.0;
+            let (mut azi1, mut s12) = (0.0, 0.0);
+            let (mut point_ok, mut segment_ok) = (false, false);
+            unsafe {
+                ffi::route_segmenter_flush(
+                    self.segmenter,
+                    &mut x,
+                    &mut y,
+                    &mut z,
+                    &mut cumulative,
+                    &mut azi1,
+                    &mut s12,
+                    &mut point_ok,
+                    &mut segment_ok,
+                )
+            };
+            Some(SegmentRecord {
+                point,
+                xyz_point: point_ok.then(|| XyzPoint {
+                    x: x * M,
+                    y: y * M,
+                    z: z * M,
+                }),
+                segment: None,
+                cumulative_distance: cumulative * M,
+            })
+        }
+    }
+
+    impl Drop for RouteSegmenter {
+        fn drop(&mut self) {
+            unsafe { ffi::route_segmenter_free(self.segmenter) }
+        }
+    }
+
+    /// Find the segments of a route passing near each of a set of waypoints.
+    ///
+    /// Equivalent to filtering every pair of waypoint and route segment by
+    /// [`crate::algorithm::intercept_distance_floor`] and then solving
+    /// [`geodesic_intercept`] for the candidates, keeping those intercepts
+    /// within `threshold`, but the whole search runs in a single FFI call on
+    /// the route's store and uses its index to skip segments that can't be
+    /// nearby.
+    /// Matches are ordered by waypoint and then by segment, and any candidate
+    /// whose interception failed is kept with its error.
+    pub fn match_waypoints(
+        route: &RouteStore,
+        waypoints: &[GeoAndXyzPoint],
+        threshold: Meter<f64>,
+        options: &InterceptOptions,
+    ) -> Vec<WaypointMatch> {
+        match_waypoints_in_segments(
+            route,
+            0..route.num_segments(),
+            &WaypointColumns::from(waypoints),
+            threshold,
+            options,
+        )
+    }
+
+    /// Find the segments among a range of a route's segments passing near each
+    /// of a set of waypoints.
+    ///
+    /// Gives exactly the matches [`match_waypoints`] would on those segments,
+    /// so that after [`RouteStore::move_point`] only its two segments need
+    /// matching again.  Ranges other than the whole route are scanned without
+    /// its index, though every waypoint is still prefiltered against them.
+    pub fn match_waypoints_in_segments(
+        route: &RouteStore,
+        segments: Range<usize>,
+        waypoints: &WaypointColumns,
+        threshold: Meter<f64>,
+        options: &InterceptOptions,
+    ) -> Vec<WaypointMatch> {
+        let n = waypoints.len();
+
+        // Most waypoints are near a route once or twice if at all, and most
+        // segments near a waypoint or two, so this rarely needs a second pass
+        // with the exact number of matches.
+        let mut capacity = 2 * n.min(segments.len()) + 16;
+        loop {
+            let mut waypoint = vec![0; capacity];
+            let mut segment = vec![0; capacity];
+            let mut lati = vec![0.0; capacity];
+            let mut loni = vec![0.0; capacity];
+            let mut spi = vec![0.0; capacity];
+            let mut s1i = vec![0.0; capacity];
+            let mut iterations = vec![0; capacity];
+            let mut ok = vec![false; capacity];
+            let num_matches = unsafe {
+                ffi::route_store_match_segments(
+                    route.store,
+                    segments.start,
+                    segments.len(),
+                    waypoints.lat.as_ptr(),
+                    waypoints.lon.as_ptr(),
+                    waypoints.x.as_ptr(),
+                    waypoints.y.as_ptr(),
+                    waypoints.z.as_ptr(),
+                    n,
+                    threshold.value_unsafe,
+                    options.tolerance.value_unsafe,
+                    options.max_iterations,
+                    capacity,
+                    waypoint.as_mut_ptr(),
+                    segment.as_mut_ptr(),
+                    lati.as_mut_ptr(),
+                    loni.as_mut_ptr(),
+                    spi.as_mut_ptr(),
+                    s1i.as_mut_ptr(),
+                    iterations.as_mut_ptr(),
+                    ok.as_mut_ptr(),
+                )
+            };
+            if num_matches > capacity {
+                capacity = num_matches;
+                continue;
+            }
+
+            let interception = |k: usize| -> Result<Interception> {
+                if ok[k] {
+                    Ok(Interception {
+                        point: GeoPoint::new(lati[k] * DEG, loni[k] * DEG, None)?,
+                        distance: spi[k] * M,
+                        offset: s1i[k] * M,
+                        iterations: iterations[k],
+                    })
+                } else {
+                    Err(GeographicError::UnknownException)
+                }
+            };
+            return (0..num_matches)
+                .map(|k| WaypointMatch {
+                    waypoint: waypoint[k],
+                    segment: segment[k],
+                    interception: interception(k),
+                })
+                .collect();
+        }
+    }
+
     pub fn geocentric_forward(point: &GeoPoint) -> Result<XyzPoint> {
         let mut x = 0.0;
         let mut y = 0.0;
@@ -207,6 +1174,48 @@ mod wrappers {
         }
     }
 
+    /// Converts many points on the ellipsoid's surface to geocentric
+    /// coordinates.
+    ///
+    /// Equivalent to calling [`geocentric_forward`] on each point, to within
+    /// nanometers, but converts the whole batch in a single vectorized FFI
+    /// call.  Native routes are converted by their [`RouteStore`], so only
+    /// tests call this.
+    #[cfg(test)]
+    pub fn geocentric_forward_batch(points: &[GeoPoint]) -> Vec<Result<XyzPoint>> {
+        let n = points.len();
+        let (lat, lon) = split_lat_lon(points);
+        let mut x = vec![0.0; n];
+        let mut y = vec![0.0; n];
+        let mut z = vec![0.0; n];
+        let mut ok = vec![false; n];
+        unsafe {
+            ffi::geocentric_forward_batch(
+                lat.as_ptr(),
+                lon.as_ptr(),
+                n,
+                x.as_mut_ptr(),
+                y.as_mut_ptr(),
+                z.as_mut_ptr(),
+                ok.as_mut_ptr(),
+            );
+        }
+
+        (0..n)
+            .map(|i| {
+                if ok[i] {
+                    Ok(XyzPoint {
+                        x: x[i] * M,
+                        y: y[i] * M,
+                        z: z[i] * M,
+                    })
+                } else {
+                    Err(GeographicError::UnknownException)
+                }
+            })
+            .collect()
+    }
+
     pub fn geographiclib_version_str() -> &'static str {
         unsafe { CStr::from_ptr(geographiclib_version()).to_str().unwrap() }
     }
@@ -215,6 +1224,30 @@ mod wrappers {
         unsafe { CStr::from_ptr(compiler_version()).to_str().unwrap() }
     }
 
+    /// Gets the instruction set the shim's batch kernels were dispatched to.
+    pub fn shim_cpu_features_str() -> &'static str {
+        unsafe { CStr::from_ptr(shim_cpu_features()).to_str().unwrap() }
+    }
+
+    /// Turns the shim's probes on or off for the whole process.
+    pub fn shim_stats_enable(enabled: bool) {
+        unsafe { ffi::shim_stats_enable(enabled) }
+    }
+
+    /// Gets what the shim's probes have recorded.
+    ///
+    /// Calls still in flight on other threads may be partly counted.
+    pub fn shim_stats_snapshot() -> Result<ShimStats> {
+        let mut stats = ShimStats::default();
+        unsafe { ffi::shim_stats_snapshot(&mut stats) };
+        Ok(stats)
+    }
+
+    /// Clears what the shim's probes have recorded.
+    pub fn shim_stats_reset() {
+        unsafe { ffi::shim_stats_reset() }
+    }
+
     /// CXX Generated FFI for GeographicLib
     ///
     /// This currently has to be inline in lib.rs because non-inline mods in
@@ -223,6 +1256,72 @@ mod wrappers {
     mod ffi {
         use std::ffi::c_char;
 
+        use crate::geographic::{
+            GeodesicCacheStats, GeodesicPath, GeodesicSolver, PrefilterPrecision, ShimStats,
+        };
+
+        /// Opaque `geo_context` from the shim
+        #[repr(C)]
+        pub struct GeoContext {
+            _private: [u8; 0],
+        }
+
+        /// Opaque `geodesic_cache` from the shim
+        #[repr(C)]
+        pub struct GeodesicCache {
+            _private: [u8; 0],
+        }
+
+        /// Opaque `route_store` from the shim
+        #[repr(C)]
+        pub struct RouteStore {
+            _private: [u8; 0],
+        }
+
+        /// Opaque `route_segmenter` from the shim
+        #[repr(C)]
+        pub struct RouteSegmenter {
+            _private: [u8; 0],
+        }
+
+        /// `route_view` from the shim
+        #[repr(C)]
+        pub struct RouteView {
+            pub n_points: usize,
+            pub lat: *const f64,
+            pub lon: *const f64,
+            pub x: *const f64,
+            pub y: *const f64,
+            pub z: *const f64,
+            pub cumulative: *const f64,
+            pub azi1: *const f64,
+            pub s12: *const f64,
+            pub depth: *const f64,
+            pub point_ok: *const bool,
+            pub segment_ok: *const bool,
+            pub path: *const GeodesicPath,
+        }
+
+        impl Default for RouteView {
+            fn default() -> Self {
+                Self {
+                    n_points: 0,
+                    lat: std::ptr::null(),
+                    lon: std::ptr::null(),
+                    x: std::ptr::null(),
+                    y: std::ptr::null(),
+                    z: std::ptr::null(),
+                    cumulative: std::ptr::null(),
+                    azi1: std::ptr::null(),
+                    s12: std::ptr::null(),
+                    depth: std::ptr::null(),
+                    point_ok: std::ptr::null(),
+                    segment_ok: std::ptr::null(),
+                    path: std::ptr::null(),
+                }
+            }
+        }
+
         unsafe extern "C" {
             pub fn geodesic_direct(
                 lat1: f64,
@@ -245,24 +1344,179 @@ mod wrappers {
                 a12: &mut f64,
             ) -> bool;
 
-            pub fn gnomonic_forward(
+            #[cfg(test)]
+            pub fn geodesic_polyline_inverse(
+                latlon: *const f64,
+                n: usize,
+                s12: *mut f64,
+                azi1: *mut f64,
+                azi2: *mut f64,
+                a12: *mut f64,
+                cumulative: *mut f64,
+                ok: *mut bool,
+            ) -> usize;
+
+            pub fn geodesic_intercept(
                 lat1: f64,
                 lon1: f64,
-                lat: f64,
-                lon: f64,
-                x: &mut f64,
-                y: &mut f64,
+                lat2: f64,
+                lon2: f64,
+                azi1: f64,
+                s12: f64,
+                latp: f64,
+                lonp: f64,
+                tolerance: f64,
+                max_iterations: u32,
+                lati: &mut f64,
+                loni: &mut f64,
+                spi: &mut f64,
+                s1i: &mut f64,
+                iterations: &mut u32,
+            ) -> bool;
+
+            pub fn geo_context_wgs84() -> *const GeoContext;
+
+            pub fn geo_context_inverse_with_solver(
+                ctx: *const GeoContext,
+                solver: GeodesicSolver,
+                lat1: f64,
+                lon1: f64,
+                lat2: f64,
+                lon2: f64,
+                s12: &mut f64,
+                azi1: &mut f64,
+                azi2: &mut f64,
+                a12: &mut f64,
+                path: &mut GeodesicPath,
+            ) -> bool;
+
+            pub fn geo_context_geodesic_cache_new(
+                ctx: *const GeoContext,
+                capacity: usize,
+            ) -> *mut GeodesicCache;
+
+            pub fn geodesic_cache_free(cache: *mut GeodesicCache);
+
+            pub fn geodesic_cache_inverse(
+                cache: *mut GeodesicCache,
+                solver: GeodesicSolver,
+                lat1: f64,
+                lon1: f64,
+                lat2: f64,
+                lon2: f64,
+                s12: &mut f64,
+                azi1: &mut f64,
+                azi2: &mut f64,
+                a12: &mut f64,
+                path: &mut GeodesicPath,
             ) -> bool;
 
-            pub fn gnomonic_reverse(
+            pub fn geodesic_cache_direct(
+                cache: *mut GeodesicCache,
                 lat1: f64,
                 lon1: f64,
-                x: f64,
-                y: f64,
-                lat: &mut f64,
-                lon: &mut f64,
+                azi1: f64,
+                s12: f64,
+                lat2: &mut f64,
+                lon2: &mut f64,
+                a12: &mut f64,
+            ) -> bool;
+
+            pub fn geodesic_cache_get_stats(
+                cache: *const GeodesicCache,
+                stats: &mut GeodesicCacheStats,
+            );
+
+            pub fn geo_context_route_store_new(
+                ctx: *const GeoContext,
+                solver: GeodesicSolver,
+                precision: PrefilterPrecision,
+                cache: *mut GeodesicCache,
+                n_points: usize,
+            ) -> *mut RouteStore;
+
+            pub fn route_store_free(store: *mut RouteStore);
+
+            pub fn route_store_load(
+                store: *mut RouteStore,
+                lat: *const f64,
+                lon: *const f64,
+                start: usize,
+                count: usize,
+            ) -> usize;
+
+            pub fn route_store_finish(store: *mut RouteStore) -> bool;
+
+            pub fn route_store_indexed(store: *const RouteStore) -> bool;
+
+            pub fn route_store_view(store: *const RouteStore, view: &mut RouteView);
+
+            pub fn route_store_move_point(
+                store: *mut RouteStore,
+                i: usize,
+                lat: f64,
+                lon: f64,
             ) -> bool;
 
+            pub fn route_store_match_segments(
+                store: *const RouteStore,
+                first_segment: usize,
+                n_segments: usize,
+                wlat: *const f64,
+                wlon: *const f64,
+                wx: *const f64,
+                wy: *const f64,
+                wz: *const f64,
+                n_waypoints: usize,
+                threshold: f64,
+                tolerance: f64,
+                max_iterations: u32,
+                capacity: usize,
+                waypoint: *mut usize,
+                segment: *mut usize,
+                lati: *mut f64,
+                loni: *mut f64,
+                spi: *mut f64,
+                s1i: *mut f64,
+                iterations: *mut u32,
+                ok: *mut bool,
+            ) -> usize;
+
+            pub fn geo_context_route_segmenter_new(
+                ctx: *const GeoContext,
+                solver: GeodesicSolver,
+            ) -> *mut RouteSegmenter;
+
+            pub fn route_segmenter_free(segmenter: *mut RouteSegmenter);
+
+            pub fn route_segmenter_push(
+                segmenter: *mut RouteSegmenter,
+                lat: *const f64,
+                lon: *const f64,
+                n: usize,
+                x: *mut f64,
+                y: *mut f64,
+                z: *mut f64,
+                cumulative: *mut f64,
+                azi1: *mut f64,
+                s12: *mut f64,
+                path: *mut GeodesicPath,
+                point_ok: *mut bool,
+                segment_ok: *mut bool,
+            ) -> usize;
+
+            pub fn route_segmenter_flush(
+                segmenter: *mut RouteSegmenter,
+                x: &mut f64,
+                y: &mut f64,
+                z: &mut f64,
+                cumulative: &mut f64,
+                azi1: &mut f64,
+                s12: &mut f64,
+                point_ok: &mut bool,
+                segment_ok: &mut bool,
+            ) -> usize;
+
             pub fn geocentric_forward(
                 lat: f64,
                 lon: f64,
@@ -272,19 +1526,47 @@ mod wrappers {
                 z: &mut f64,
             ) -> bool;
 
-            pub fn geographiclib_version() -> *const c_char;
+            #[cfg(test)]
+            pub fn geocentric_forward_batch(
+                lat: *const f64,
+                lon: *const f64,
+                n: usize,
+                x: *mut f64,
+                y: *mut f64,
+                z: *mut f64,
+                ok: *mut bool,
+            ) -> usize;
 
-            pub fn compiler_version() -> *const c_char;
+            pub fn shim_stats_enable(enabled: bool);
+
+            pub fn shim_stats_snapshot(stats: &mut ShimStats);
+
+            pub fn shim_stats_reset();
+
+            pub fn geographiclib_version() -> *const c_char;
+
+            pub fn compiler_version() -> *const c_char;
+
+            pub fn shim_cpu_features() -> *const c_char;
         }
     }
 }
 
 #[cfg(feature = "jsffi")]
 mod wrappers {
+    use std::ops::Range;
+    use std::sync::atomic::{AtomicU64, Ordering};
+
     use dimensioned::si::{M, Meter};
+    use js_sys::{Float64Array, Reflect, Uint8Array};
+    use wasm_bindgen::JsValue;
 
-    use crate::geographic::{DirectSolution, GeographicError, InverseSolution, Result};
-    use crate::types::{XyPoint, XyzPoint};
+    use crate::geographic::{
+        DirectSolution, GeodesicCacheStats, GeodesicPath, GeodesicSolver, GeographicError,
+        InterceptOptions, Interception, InverseSolution, PolylineSolution, PrefilterPrecision,
+        Result, RouteSegment, SegmentRecord, ShimStats, WaypointColumns, WaypointMatch,
+    };
+    use crate::types::{GeoAndXyzPoint, XyzPoint};
     use crate::{DEG, Degree, GeoPoint};
 
     pub fn geodesic_direct(
@@ -292,192 +1574,1096 @@ mod wrappers {
         azimuth: Degree<f64>,
         distance: Meter<f64>,
     ) -> Result<DirectSolution> {
-        let out_js = ffi::geodesic_direct(
-            point1.lat().value_unsafe,
-            point1.lon().value_unsafe,
-            azimuth.value_unsafe,
-            distance.value_unsafe,
-        );
-        let out: ffi::DirectSolution = serde_wasm_bindgen::from_value(out_js)
-            .map_err(|_| GeographicError::Json("DirectSolution".to_owned()))?;
-        if out.ok {
-            Ok(DirectSolution {
-                arc_distance: out.a12 * DEG,
-                point2: GeoPoint::new(out.lat2 * DEG, out.lon2 * DEG, None)?,
-            })
-        } else {
-            Err(GeographicError::UnknownException)
-        }
+        let block = call_with_outputs(|[lat2, lon2, a12]| {
+            ffi::geodesic_direct(
+                point1.lat().value_unsafe,
+                point1.lon().value_unsafe,
+                azimuth.value_unsafe,
+                distance.value_unsafe,
+                lat2,
+                lon2,
+                a12,
+            )
+        })?;
+        let out = block.read_f64(0, 3)?;
+        Ok(DirectSolution {
+            arc_distance: out[2] * DEG,
+            point2: GeoPoint::new(out[0] * DEG, out[1] * DEG, None)?,
+        })
     }
 
     pub fn geodesic_inverse(point1: &GeoPoint, point2: &GeoPoint) -> Result<InverseSolution> {
-        let out_js = ffi::geodesic_inverse(
-            point1.lat().value_unsafe,
-            point1.lon().value_unsafe,
-            point2.lat().value_unsafe,
-            point2.lon().value_unsafe,
-        );
-        let out: ffi::InverseSolution = serde_wasm_bindgen::from_value(out_js)
-            .map_err(|_| GeographicError::Json("InverseSolution".to_owned()))?;
-        if out.ok {
-            Ok(InverseSolution {
-                arc_distance: out.a12 * DEG,
-                geo_distance: out.s12 * M,
-                azimuth1: out.azi1 * DEG,
-                azimuth2: out.azi2 * DEG,
-            })
-        } else {
-            Err(GeographicError::UnknownException)
+        let block = call_with_outputs(|[s12, azi1, azi2, a12]| {
+            ffi::geodesic_inverse_with_azimuth(
+                point1.lat().value_unsafe,
+                point1.lon().value_unsafe,
+                point2.lat().value_unsafe,
+                point2.lon().value_unsafe,
+                s12,
+                azi1,
+                azi2,
+                a12,
+            )
+        })?;
+        let out = block.read_f64(0, 4)?;
+        Ok(InverseSolution {
+            arc_distance: out[3] * DEG,
+            geo_distance: out[0] * M,
+            azimuth1: out[1] * DEG,
+            azimuth2: out[2] * DEG,
+        })
+    }
+
+    /// The web app's module is built without the exact solver, which then
+    /// falls back to the series solver and reports it as the path taken.
+    pub fn geodesic_inverse_with_solver(
+        point1: &GeoPoint,
+        point2: &GeoPoint,
+        solver: GeodesicSolver,
+    ) -> Result<(InverseSolution, GeodesicPath)> {
+        let block = call_with_outputs(|[s12, azi1, azi2, a12, path]| {
+            ffi::geo_context_inverse_with_solver(
+                ffi::geo_context_wgs84(),
+                solver as u32,
+                point1.lat().value_unsafe,
+                point1.lon().value_unsafe,
+                point2.lat().value_unsafe,
+                point2.lon().value_unsafe,
+                s12,
+                azi1,
+                azi2,
+                a12,
+                path,
+            )
+        })?;
+        let out = block.read_f64(0, 4)?;
+        let path = read_module_u32(block.f64_ptr(4), 1)?[0];
+        Ok((
+            InverseSolution {
+                arc_distance: out[3] * DEG,
+                geo_distance: out[0] * M,
+                azimuth1: out[1] * DEG,
+                azimuth2: out[2] * DEG,
+            },
+            geodesic_path(path),
+        ))
+    }
+
+    // Every call into the module passes plain numbers and addresses to the
+    // shim's C functions.  Arrays, and the outputs of scalar calls, are
+    // staged in the GeographicLib module's own heap (see `ModuleHeap`), so
+    // that a whole batch costs a single call into the module and creates no JS
+    // objects per element.
+
+    /// Solves the inverse problem between each pair of adjacent points, for
+    /// the segmenter.
+    pub fn geodesic_polyline_inverse(points: &[GeoPoint]) -> PolylineSolution {
+        let n = points.len();
+        let num_segments = n.saturating_sub(1);
+        let latlon = points
+            .iter()
+            .flat_map(|p| [p.lat().value_unsafe, p.lon().value_unsafe])
+            .collect::<Vec<_>>();
+        let output_lens = [num_segments, num_segments, num_segments, num_segments, n];
+        let staged = call_with_module_heap(&[&latlon], &output_lens, num_segments, |i, o, ok| {
+            ffi::geodesic_polyline_inverse(i[0], n, o[0], o[1], o[2], o[3], o[4], ok);
+        });
+        let (outputs, ok) = match staged {
+            Ok(staged) => staged,
+            Err(e) => {
+                return PolylineSolution {
+                    segments: batch_error(num_segments, e),
+                    cumulative_distances: vec![f64::NAN * M; n],
+                };
+            }
+        };
+        let (s12, azi1, azi2, a12) = (&outputs[0], &outputs[1], &outputs[2], &outputs[3]);
+
+        PolylineSolution {
+            segments: (0..num_segments)
+                .map(|i| {
+                    if ok[i] {
+                        Ok(InverseSolution {
+                            arc_distance: a12[i] * DEG,
+                            geo_distance: s12[i] * M,
+                            azimuth1: azi1[i] * DEG,
+                            azimuth2: azi2[i] * DEG,
+                        })
+                    } else {
+                        Err(GeographicError::UnknownException)
+                    }
+                })
+                .collect(),
+            cumulative_distances: outputs[4].iter().map(|d| d * M).collect(),
         }
     }
 
-    pub fn gnomonic_forward(point0: &GeoPoint, point: &GeoPoint) -> Result<XyPoint> {
-        let out_js = ffi::gnomonic_forward(
-            point0.lat().value_unsafe,
-            point0.lon().value_unsafe,
-            point.lat().value_unsafe,
-            point.lon().value_unsafe,
-        );
-        let out: ffi::XyPoint = serde_wasm_bindgen::from_value(out_js)
-            .map_err(|_| GeographicError::Json("XyPoint".to_owned()))?;
-        if out.ok {
-            Ok(XyPoint {
-                x: out.x * M,
-                y: out.y * M,
+    /// Splits points into parallel arrays of latitudes and longitudes
+    fn split_lat_lon(points: &[GeoPoint]) -> (Vec<f64>, Vec<f64>) {
+        points
+            .iter()
+            .map(|p| (p.lat().value_unsafe, p.lon().value_unsafe))
+            .unzip()
+    }
+
+    /// Fails every element of a batch that couldn't be staged
+    fn batch_error<T>(n: usize, error: GeographicError) -> Vec<Result<T>> {
+        let message = match error {
+            GeographicError::ModuleHeap(message) => message,
+            e => e.to_string(),
+        };
+        (0..n)
+            .map(|_| Err(GeographicError::ModuleHeap(message.clone())))
+            .collect()
+    }
+
+    /// A block of memory allocated in the GeographicLib module's heap
+    ///
+    /// The Emscripten module has its own linear memory, separate from ours,
+    /// so pointers to our own arrays mean nothing to it.  Instead, the block
+    /// holds `num_f64` doubles followed by `num_bool` bools, which are copied
+    /// in and out through typed array views of the module's heap.
+    struct ModuleHeap {
+        ptr: usize,
+        num_f64: usize,
+        num_bool: usize,
+    }
+
+    impl ModuleHeap {
+        fn alloc(num_f64: usize, num_bool: usize) -> Result<Self> {
+            // Never ask for zero bytes, for which malloc may return null.
+            let ptr = ffi::malloc((8 * num_f64 + num_bool).max(1));
+            if ptr == 0 {
+                return Err(GeographicError::ModuleHeap("allocation failed".to_owned()));
+            }
+            Ok(Self {
+                ptr,
+                num_f64,
+                num_bool,
             })
-        } else {
-            Err(GeographicError::UnknownException)
+        }
+
+        /// Returns the module address of the `i`-th double in the block.
+        fn f64_ptr(&self, i: usize) -> usize {
+            debug_assert!(i <= self.num_f64);
+            self.ptr + 8 * i
+        }
+
+        /// Returns the module address of the `i`-th bool in the block.
+        fn bool_ptr(&self, i: usize) -> usize {
+            debug_assert!(i <= self.num_bool);
+            self.ptr + 8 * self.num_f64 + i
+        }
+
+        fn write_f64(&self, i: usize, values: &[f64]) -> Result<()> {
+            let heap = module_heap::<Float64Array>()?;
+            // SAFETY: The view of our memory is consumed before anything can
+            // allocate in our heap and invalidate it.
+            let view = unsafe { Float64Array::view(values) };
+            heap.set(&view, (self.f64_ptr(i) / 8) as u32);
+            Ok(())
+        }
+
+        fn read_f64(&self, i: usize, len: usize) -> Result<Vec<f64>> {
+            read_module_f64(self.f64_ptr(i), len)
+        }
+
+        fn read_bool(&self, i: usize, len: usize) -> Result<Vec<bool>> {
+            read_module_bool(self.bool_ptr(i), len)
         }
     }
 
-    pub fn gnomonic_reverse(point0: &GeoPoint, xypoint: &XyPoint) -> Result<GeoPoint> {
-        let out_js = ffi::gnomonic_reverse(
-            point0.lat().value_unsafe,
-            point0.lon().value_unsafe,
-            xypoint.x.value_unsafe,
-            xypoint.y.value_unsafe,
-        );
-        let out: ffi::GeoPoint = serde_wasm_bindgen::from_value(out_js)
-            .map_err(|_| GeographicError::Json("GeoPoint".to_owned()))?;
-        if out.ok {
-            Ok(GeoPoint::new(out.lat * DEG, out.lon * DEG, None)?)
-        } else {
-            Err(GeographicError::UnknownException)
+    /// Reads `len` doubles from the module's heap at address `ptr`.
+    fn read_module_f64(ptr: usize, len: usize) -> Result<Vec<f64>> {
+        let heap = module_heap::<Float64Array>()?;
+        let start = (ptr / 8) as u32;
+        let mut values = vec![0.0; len];
+        heap.subarray(start, start + len as u32)
+            .copy_to(&mut values);
+        Ok(values)
+    }
+
+    /// Reads `len` bytes from the module's heap at address `ptr`.
+    fn read_module_u8(ptr: usize, len: usize) -> Result<Vec<u8>> {
+        let heap = module_heap::<Uint8Array>()?;
+        let start = ptr as u32;
+        let mut values = vec![0u8; len];
+        heap.subarray(start, start + len as u32)
+            .copy_to(&mut values);
+        Ok(values)
+    }
+
+    /// Reads `len` bools from the module's heap at address `ptr`.
+    fn read_module_bool(ptr: usize, len: usize) -> Result<Vec<bool>> {
+        Ok(read_module_u8(ptr, len)?
+            .into_iter()
+            .map(|b| b != 0)
+            .collect())
+    }
+
+    /// Reads `len` 32-bit words from the module's heap at address `ptr`, as
+    /// its `size_t`s, pointers, `unsigned`s and enums all are.
+    fn read_module_u32(ptr: usize, len: usize) -> Result<Vec<u32>> {
+        Ok(read_module_u8(ptr, 4 * len)?
+            .chunks_exact(4)
+            .map(|b| u32::from_le_bytes([b[0], b[1], b[2], b[3]]))
+            .collect())
+    }
+
+    impl Drop for ModuleHeap {
+        fn drop(&mut self) {
+            ffi::free(self.ptr);
         }
     }
 
-    pub fn geocentric_forward(point: &GeoPoint) -> Result<XyzPoint> {
-        let out_js =
-            ffi::geocentric_forward(point.lat().value_unsafe, point.lon().value_unsafe, 0.0);
-        let out: ffi::XyzPoint = serde_wasm_bindgen::from_value(out_js)
-            .map_err(|_| GeographicError::Json("XyzPoint".to_owned()))?;
-        if out.ok {
-            Ok(XyzPoint {
-                x: out.x * M,
-                y: out.y * M,
-                z: out.z * M,
+    /// Calls a shim batch function on arrays staged in the module's heap
+    ///
+    /// Copies each of `inputs` into a [`ModuleHeap`] block, allocates output
+    /// arrays of `output_lens` doubles plus an `ok` array of `num_ok` bools
+    /// after them, and passes `call` the module addresses of the inputs, the
+    /// outputs, and `ok`.  Returns the contents of the outputs and `ok`.
+    fn call_with_module_heap<F>(
+        inputs: &[&[f64]],
+        output_lens: &[usize],
+        num_ok: usize,
+        call: F,
+    ) -> Result<(Vec<Vec<f64>>, Vec<bool>)>
+    where
+        F: FnOnce(&[usize], &[usize], usize),
+    {
+        let num_inputs = inputs.iter().map(|a| a.len()).sum::<usize>();
+        let block = ModuleHeap::alloc(num_inputs + output_lens.iter().sum::<usize>(), num_ok)?;
+
+        let mut offset = 0;
+        let mut input_ptrs = Vec::with_capacity(inputs.len());
+        for input in inputs {
+            block.write_f64(offset, input)?;
+            input_ptrs.push(block.f64_ptr(offset));
+            offset += input.len();
+        }
+        let output_offsets = output_lens
+            .iter()
+            .scan(offset, |next, len| {
+                let start = *next;
+                *next += len;
+                Some(start)
             })
+            .collect::<Vec<_>>();
+        let output_ptrs = output_offsets
+            .iter()
+            .map(|i| block.f64_ptr(*i))
+            .collect::<Vec<_>>();
+
+        call(&input_ptrs, &output_ptrs, block.bool_ptr(0));
+
+        // The module's heap views are fetched afresh for each read, since the
+        // call may have grown its memory and detached earlier views.
+        let outputs = output_offsets
+            .iter()
+            .zip(output_lens)
+            .map(|(i, len)| block.read_f64(*i, *len))
+            .collect::<Result<Vec<_>>>()?;
+        Ok((outputs, block.read_bool(0, num_ok)?))
+    }
+
+    /// Calls a scalar shim function with `N` output slots in the module's heap
+    ///
+    /// Passes `call` the module address of each slot, which is eight bytes
+    /// wide, and returns the [`ModuleHeap`] block holding them if the call
+    /// succeeds, for its outputs to be read back.
+    fn call_with_outputs<const N: usize, F>(call: F) -> Result<ModuleHeap>
+    where
+        F: FnOnce([usize; N]) -> bool,
+    {
+        let block = ModuleHeap::alloc(N, 0)?;
+        if call(std::array::from_fn(|i| block.f64_ptr(i))) {
+            Ok(block)
         } else {
             Err(GeographicError::UnknownException)
         }
     }
 
-    pub fn geographiclib_version_str() -> String {
-        ffi::geographiclib_version()
+    /// Converts a `geodesic_path` reported by the module
+    fn geodesic_path(path: u32) -> GeodesicPath {
+        match path {
+            1 => GeodesicPath::Exact,
+            2 => GeodesicPath::TangentPlane,
+            _ => GeodesicPath::Series,
+        }
     }
 
-    pub fn compiler_version_str() -> String {
-        ffi::compiler_version()
+    /// A typed array type that can view the module's heap
+    trait HeapView {
+        fn over(buffer: &JsValue) -> Self;
     }
 
-    mod ffi {
-        use serde::Deserialize;
-        use wasm_bindgen::prelude::*;
+    impl HeapView for Float64Array {
+        fn over(buffer: &JsValue) -> Self {
+            Float64Array::new(buffer)
+        }
+    }
+
+    impl HeapView for Uint8Array {
+        fn over(buffer: &JsValue) -> Self {
+            Uint8Array::new(buffer)
+        }
+    }
 
-        #[derive(Deserialize)]
-        #[serde(rename_all = "camelCase")]
-        pub struct DirectSolution {
-            pub ok: bool,
-            pub lat2: f64,
-            pub lon2: f64,
-            pub a12: f64,
+    /// Returns a typed array view of the GeographicLib module's heap
+    ///
+    /// The view is made afresh over the module's `wasmMemory`, so that it
+    /// covers the memory's current buffer even after an allocation grew it.
+    fn module_heap<T: HeapView>() -> Result<T> {
+        let lookup = |target: &JsValue, key: &str| {
+            Reflect::get(target, &JsValue::from_str(key))
+                .map_err(|_| GeographicError::ModuleHeap(format!("missing {key}")))
+        };
+        let window = lookup(&JsValue::from(js_sys::global()), "window")?;
+        let module = lookup(&window, "GEO")?;
+        let buffer = lookup(&lookup(&module, "wasmMemory")?, "buffer")?;
+        if !buffer.is_object() {
+            return Err(GeographicError::ModuleHeap(
+                "wasmMemory has no buffer".to_owned(),
+            ));
         }
+        Ok(T::over(&buffer))
+    }
 
-        #[wasm_bindgen]
-        extern "C" {
-            #[wasm_bindgen(js_namespace = ["window", "GEO"])]
-            pub fn geodesic_direct(lat1: f64, lon1: f64, azi1: f64, s12: f64) -> JsValue;
+    pub fn geodesic_intercept(
+        start: &GeoPoint,
+        end: &GeoPoint,
+        start_azimuth: Degree<f64>,
+        length: Meter<f64>,
+        point: &GeoPoint,
+        options: &InterceptOptions,
+    ) -> Result<Interception> {
+        let block = call_with_outputs(|[lati, loni, spi, s1i, iterations]| {
+            ffi::geodesic_intercept(
+                start.lat().value_unsafe,
+                start.lon().value_unsafe,
+                end.lat().value_unsafe,
+                end.lon().value_unsafe,
+                start_azimuth.value_unsafe,
+                length.value_unsafe,
+                point.lat().value_unsafe,
+                point.lon().value_unsafe,
+                options.tolerance.value_unsafe,
+                options.max_iterations,
+                lati,
+                loni,
+                spi,
+                s1i,
+                iterations,
+            )
+        })?;
+        let out = block.read_f64(0, 4)?;
+        Ok(Interception {
+            point: GeoPoint::new(out[0] * DEG, out[1] * DEG, None)?,
+            distance: out[2] * M,
+            offset: out[3] * M,
+            iterations: read_module_u32(block.f64_ptr(4), 1)?[0],
+        })
+    }
+
+    /// The web module has no cache, so this solves every problem afresh,
+    /// and counts each as a miss.
+    pub struct GeodesicCache {
+        inverse_misses: AtomicU64,
+        direct_misses: AtomicU64,
+    }
+
+    impl GeodesicCache {
+        pub fn new(capacity: usize) -> Result<Self> {
+            if capacity == 0 {
+                return Err(GeographicError::UnknownException);
+            }
+            Ok(Self {
+                inverse_misses: AtomicU64::new(0),
+                direct_misses: AtomicU64::new(0),
+            })
         }
 
-        #[derive(Deserialize)]
-        #[serde(rename_all = "camelCase")]
-        pub struct InverseSolution {
-            pub ok: bool,
-            pub s12: f64,
-            pub azi1: f64,
-            pub azi2: f64,
-            pub a12: f64,
+        pub fn inverse(
+            &self,
+            point1: &GeoPoint,
+            point2: &GeoPoint,
+            solver: GeodesicSolver,
+        ) -> Result<(InverseSolution, GeodesicPath)> {
+            self.inverse_misses.fetch_add(1, Ordering::Relaxed);
+            geodesic_inverse_with_solver(point1, point2, solver)
         }
 
-        #[wasm_bindgen]
-        extern "C" {
-            #[wasm_bindgen(js_namespace = ["window", "GEO"])]
-            pub fn geodesic_inverse(lat1: f64, lon1: f64, lat2: f64, lon2: f64) -> JsValue;
+        pub fn direct(
+            &self,
+            point1: &GeoPoint,
+            azimuth: Degree<f64>,
+            distance: Meter<f64>,
+        ) -> Result<DirectSolution> {
+            self.direct_misses.fetch_add(1, Ordering::Relaxed);
+            geodesic_direct(point1, azimuth, distance)
         }
 
-        #[derive(Deserialize)]
-        #[serde(rename_all = "camelCase")]
-        pub struct XyPoint {
-            pub ok: bool,
-            pub x: f64,
-            pub y: f64,
+        pub fn stats(&self) -> GeodesicCacheStats {
+            GeodesicCacheStats {
+                inverse_misses: self.inverse_misses.load(Ordering::Relaxed),
+                direct_misses: self.direct_misses.load(Ordering::Relaxed),
+                ..GeodesicCacheStats::default()
+            }
         }
+    }
 
-        #[wasm_bindgen]
-        extern "C" {
-            #[wasm_bindgen(js_namespace = ["window", "GEO"])]
-            pub fn gnomonic_forward(lat0: f64, lon0: f64, lat: f64, lon: f64) -> JsValue;
+    /// The number of words in the module's `route_view`: its point count
+    /// and twelve column pointers.
+    const ROUTE_VIEW_WORDS: usize = 13;
+
+    /// A route loaded into the module's native segment store.
+    ///
+    /// The route is staged in the module's heap and loaded in a single call.
+    /// Its columns are then copied back once, so that reading a point or
+    /// segment doesn't cross into JavaScript, while matching works on the
+    /// store by handle.  Caches here aren't backed by the module's, so each
+    /// segment counts as a miss of any cache given.
+    pub struct RouteStore {
+        store: usize,
+        /// The module's `route_view` of the store: its point count followed
+        /// by the addresses of its columns
+        view: Vec<u32>,
+        points: Vec<GeoPoint>,
+        xyz_points: Vec<Option<XyzPoint>>,
+        segments: Vec<Option<RouteSegment>>,
+        cumulative_distances: Vec<Meter<f64>>,
+    }
+
+    impl RouteStore {
+        pub fn new(
+            points: &[GeoPoint],
+            solver: GeodesicSolver,
+            precision: PrefilterPrecision,
+            cache: Option<&GeodesicCache>,
+        ) -> Result<Self> {
+            let n = points.len();
+            let store = ffi::geo_context_route_store_new(
+                ffi::geo_context_wgs84(),
+                solver as u32,
+                precision as u32,
+                0,
+                n,
+            );
+            if store == 0 {
+                return Err(GeographicError::UnknownException);
+            }
+            let mut route = Self {
+                store,
+                view: Vec::new(),
+                points: points.to_vec(),
+                xyz_points: Vec::new(),
+                segments: Vec::new(),
+                cumulative_distances: Vec::new(),
+            };
+
+            let (lat, lon) = split_lat_lon(points);
+            let staged = ModuleHeap::alloc(2 * n, 0)?;
+            staged.write_f64(0, &lat)?;
+            staged.write_f64(n, &lon)?;
+            ffi::route_store_load(store, staged.f64_ptr(0), staged.f64_ptr(n), 0, n);
+            ffi::route_store_finish(store);
+            if let Some(cache) = cache {
+                cache
+                    .inverse_misses
+                    .fetch_add(n.saturating_sub(1) as u64, Ordering::Relaxed);
+            }
+
+            let view = ModuleHeap::alloc(ROUTE_VIEW_WORDS.div_ceil(2), 0)?;
+            ffi::route_store_view(store, view.f64_ptr(0));
+            route.view = read_module_u32(view.f64_ptr(0), ROUTE_VIEW_WORDS)?;
+            route.read_columns(0)?;
+            Ok(route)
         }
 
-        #[derive(Deserialize)]
-        #[serde(rename_all = "camelCase")]
-        pub struct GeoPoint {
-            pub ok: bool,
-            pub lat: f64,
-            pub lon: f64,
+        /// Copies the store's columns back from point and segment `start`
+        /// onward.
+        fn read_columns(&mut self, start: usize) -> Result<()> {
+            // After n_points, the view holds the addresses of lat, lon, x, y, z,
+            // cumulative, azi1, s12, depth, point_ok, segment_ok, and path.
+            let words = &self.view;
+            let n = self.points.len() - start;
+            let num_segments = self.points.len().saturating_sub(1) - start;
+            let column = |w: usize, len: usize| read_module_f64(words[w] as usize + 8 * start, len);
+
+            let (x, y, z) = (column(3, n)?, column(4, n)?, column(5, n)?);
+            self.xyz_points.truncate(start);
+            self.xyz_points.extend(
+                read_module_bool(words[10] as usize + start, n)?
+                    .into_iter()
+                    .enumerate()
+                    .map(|(i, ok)| {
+                        ok.then(|| XyzPoint {
+                            x: x[i] * M,
+                            y: y[i] * M,
+                            z: z[i] * M,
+                        })
+                    }),
+            );
+
+            let (azi1, s12) = (column(7, num_segments)?, column(8, num_segments)?);
+            let path = read_module_u32(words[12] as usize + 4 * start, num_segments)?;
+            self.segments.truncate(start);
+            self.segments.extend(
+                read_module_bool(words[11] as usize + start, num_segments)?
+                    .into_iter()
+                    .enumerate()
+                    .map(|(i, ok)| {
+                        ok.then(|| RouteSegment {
+                            start_azimuth: azi1[i] * DEG,
+                            length: s12[i] * M,
+                            path: geodesic_path(path[i]),
+                        })
+                    }),
+            );
+
+            self.cumulative_distances.truncate(start);
+            self.cumulative_distances
+                .extend(column(6, n)?.into_iter().map(|d| d * M));
+            Ok(())
         }
 
-        #[wasm_bindgen]
-        extern "C" {
-            #[wasm_bindgen(js_namespace = ["window", "GEO"])]
-            pub fn gnomonic_reverse(lat0: f64, lon0: f64, x: f64, y: f64) -> JsValue;
+        pub fn num_points(&self) -> usize {
+            self.points.len()
         }
 
-        #[derive(Deserialize)]
-        #[serde(rename_all = "camelCase")]
-        pub struct XyzPoint {
-            pub ok: bool,
-            pub x: f64,
-            pub y: f64,
-            pub z: f64,
+        pub fn num_segments(&self) -> usize {
+            self.segments.len()
         }
 
-        #[wasm_bindgen]
-        extern "C" {
-            #[wasm_bindgen(js_namespace = ["window", "GEO"])]
-            pub fn geocentric_forward(lat: f64, lon: f64, h: f64) -> JsValue;
+        pub fn is_indexed(&self) -> bool {
+            ffi::route_store_indexed(self.store)
         }
 
-        #[wasm_bindgen]
-        extern "C" {
-            #[wasm_bindgen(js_namespace = ["window", "GEO"])]
-            pub fn geographiclib_version() -> String;
+        pub fn xyz_point(&self, i: usize) -> Result<XyzPoint> {
+            self.xyz_points[i].ok_or(GeographicError::UnknownException)
         }
 
+        pub fn segment(&self, i: usize) -> Result<RouteSegment> {
+            self.segments[i].ok_or(GeographicError::UnknownException)
+        }
+
+        pub fn cumulative_distance(&self, i: usize) -> Meter<f64> {
+            self.cumulative_distances[i]
+        }
+
+        /// Moves the point in the module's store, then copies back the
+        /// columns from its first segment onward, since every cumulative
+        /// distance after it may have changed.
+        pub fn move_point(&mut self, i: usize, point: &GeoPoint) -> Result<()> {
+            assert!(i < self.num_points());
+            let ok = ffi::route_store_move_point(
+                self.store,
+                i,
+                point.lat().value_unsafe,
+                point.lon().value_unsafe,
+            );
+            self.points[i] = *point;
+            self.read_columns(i.saturating_sub(1))?;
+            if ok {
+                Ok(())
+            } else {
+                Err(GeographicError::UnknownException)
+            }
+        }
+    }
+
+    impl Drop for RouteStore {
+        fn drop(&mut self) {
+            ffi::route_store_free(self.store);
+        }
+    }
+
+    /// The web module has no streaming segmenter, so this solves each
+    /// chunk, joined to the pending point, with the batch calls, whose series
+    /// solver stands in for every policy.
+    pub struct RouteSegmenter {
+        pending: Option<GeoPoint>,
+        cumulative_distance: Meter<f64>,
+    }
+
+    impl RouteSegmenter {
+        pub fn new(_solver: GeodesicSolver) -> Result<Self> {
+            Ok(Self {
+                pending: None,
+                cumulative_distance: 0.0 * M,
+            })
+        }
+
+        pub fn push(&mut self, points: &[GeoPoint], records: &mut Vec<SegmentRecord>) {
+            let Some(last) = points.last() else {
+                return;
+            };
+            let chain = self
+                .pending
+                .iter()
+                .chain(points.iter())
+                .copied()
+                .collect::<Vec<_>>();
+            let emitted = &chain[..chain.len() - 1];
+            let polyline = geodesic_polyline_inverse(&chain);
+            let length = polyline.cumulative_distances[chain.len() - 1];
+            let xyz_points = geocentric_forward_batch(emitted);
+            for ((point, xyz), (inverse, cumulative)) in emitted.iter().zip(xyz_points).zip(
+                polyline
+                    .segments
+                    .into_iter()
+                    .zip(polyline.cumulative_distances),
+            ) {
+                records.push(SegmentRecord {
+                    point: *point,
+                    xyz_point: xyz.ok(),
+                    segment: inverse.ok().map(|inverse| RouteSegment {
+                        start_azimuth: inverse.azimuth1,
+                        length: inverse.geo_distance,
+                        path: GeodesicPath::Series,
+                    }),
+                    cumulative_distance: self.cumulative_distance + cumulative,
+                });
+            }
+            self.cumulative_distance = self.cumulative_distance + length;
+            self.pending = Some(*last);
+        }
+
+        pub fn flush(&mut self) -> Option<SegmentRecord> {
+            let point = self.pending.take()?;
+            let cumulative_distance = self.cumulative_distance;
+            self.cumulative_distance = 0.0 * M;
+            Some(SegmentRecord {
+                point,
+                xyz_point: geocentric_forward(&point).ok(),
+                segment: None,
+                cumulative_distance,
+            })
+        }
+    }
+
+    /// Matches waypoints against a route's store in a single call into the
+    /// module's matching engine.
+    ///
+    /// Matches are ordered by waypoint and then by segment.  If the waypoints
+    /// can't be staged in the module's heap, each is matched to the route's
+    /// first segment with the error.
+    pub fn match_waypoints(
+        route: &RouteStore,
+        waypoints: &[GeoAndXyzPoint],
+        threshold: Meter<f64>,
+        options: &InterceptOptions,
+    ) -> Vec<WaypointMatch> {
+        match_waypoints_in_segments(
+            route,
+            0..route.num_segments(),
+            &WaypointColumns::from(waypoints),
+            threshold,
+            options,
+        )
+    }
+
+    /// Matches waypoints against a range of a route's segments, as
+    /// [`match_waypoints`] does against the whole route.  Errors staging the
+    /// waypoints are reported on the range's first segment.
+    pub fn match_waypoints_in_segments(
+        route: &RouteStore,
+        segments: Range<usize>,
+        waypoints: &WaypointColumns,
+        threshold: Meter<f64>,
+        options: &InterceptOptions,
+    ) -> Vec<WaypointMatch> {
+        // Most waypoints are near a route once or twice if at all, and most
+        // segments near a waypoint or two, so this rarely needs a second pass
+        // with the exact number of matches.
+        let mut capacity = 2 * waypoints.len().min(segments.len()) + 16;
+        loop {
+            match staged_match_waypoints(
+                route,
+                segments.clone(),
+                waypoints,
+                threshold,
+                options,
+                capacity,
+            ) {
+                Ok((num_matches, _)) if num_matches > capacity => capacity = num_matches,
+                Ok((_, matches)) => return matches,
+                Err(e) if !segments.is_empty() => {
+                    return batch_error(waypoints.len(), e)
+                        .into_iter()
+                        .enumerate()
+                        .map(|(w, interception)| WaypointMatch {
+                            waypoint: w,
+                            segment: segments.start,
+                            interception,
+                        })
+                        .collect();
+                }
+                Err(_) => return Vec::new(),
+            }
+        }
+    }
+
+    /// Runs the module's matching engine over a range of segments with room
+    /// for `capacity` matches, returning the total number of matches and
+    /// those that fit
+    fn staged_match_waypoints(
+        route: &RouteStore,
+        segments: Range<usize>,
+        waypoints: &WaypointColumns,
+        threshold: Meter<f64>,
+        options: &InterceptOptions,
+        capacity: usize,
+    ) -> Result<(usize, Vec<WaypointMatch>)> {
+        let n = waypoints.len();
+        let columns = [
+            &waypoints.lat,
+            &waypoints.lon,
+            &waypoints.x,
+            &waypoints.y,
+            &waypoints.z,
+        ];
+
+        // The waypoint, segment, and iteration outputs are 32-bit words, each
+        // given a column of doubles to keep the block's layout simple.
+        let block = ModuleHeap::alloc(5 * n + 7 * capacity, capacity)?;
+        for (c, column) in columns.iter().enumerate() {
+            block.write_f64(c * n, column)?;
+        }
+        let output = |k: usize| block.f64_ptr(5 * n + k * capacity);
+        let num_matches = ffi::route_store_match_segments(
+            route.store,
+            segments.start,
+            segments.len(),
+            block.f64_ptr(0),
+            block.f64_ptr(n),
+            block.f64_ptr(2 * n),
+            block.f64_ptr(3 * n),
+            block.f64_ptr(4 * n),
+            n,
+            threshold.value_unsafe,
+            options.tolerance.value_unsafe,
+            options.max_iterations,
+            capacity,
+            output(0),
+            output(1),
+            output(2),
+            output(3),
+            output(4),
+            output(5),
+            output(6),
+            block.bool_ptr(0),
+        );
+        if num_matches > capacity {
+            return Ok((num_matches, Vec::new()));
+        }
+
+        let waypoint = read_module_u32(output(0), num_matches)?;
+        let segment = read_module_u32(output(1), num_matches)?;
+        let lati = read_module_f64(output(2), num_matches)?;
+        let loni = read_module_f64(output(3), num_matches)?;
+        let spi = read_module_f64(output(4), num_matches)?;
+        let s1i = read_module_f64(output(5), num_matches)?;
+        let iterations = read_module_u32(output(6), num_matches)?;
+        let ok = block.read_bool(0, num_matches)?;
+        let interception = |k: usize| -> Result<Interception> {
+            if ok[k] {
+                Ok(Interception {
+                    point: GeoPoint::new(lati[k] * DEG, loni[k] * DEG, None)?,
+                    distance: spi[k] * M,
+                    offset: s1i[k] * M,
+                    iterations: iterations[k],
+                })
+            } else {
+                Err(GeographicError::UnknownException)
+            }
+        };
+        let matches = (0..num_matches)
+            .map(|k| WaypointMatch {
+                waypoint: waypoint[k] as usize,
+                segment: segment[k] as usize,
+                interception: interception(k),
+            })
+            .collect();
+        Ok((num_matches, matches))
+    }
+
+    pub fn geocentric_forward(point: &GeoPoint) -> Result<XyzPoint> {
+        let block = call_with_outputs(|[x, y, z]| {
+            ffi::geocentric_forward(
+                point.lat().value_unsafe,
+                point.lon().value_unsafe,
+                0.0,
+                x,
+                y,
+                z,
+            )
+        })?;
+        let out = block.read_f64(0, 3)?;
+        Ok(XyzPoint {
+            x: out[0] * M,
+            y: out[1] * M,
+            z: out[2] * M,
+        })
+    }
+
+    /// Converts many points to geocentric coordinates in one call, for the
+    /// segmenter.
+    pub fn geocentric_forward_batch(points: &[GeoPoint]) -> Vec<Result<XyzPoint>> {
+        let n = points.len();
+        let (lat, lon) = split_lat_lon(points);
+        let staged = call_with_module_heap(&[&lat, &lon], &[n; 3], n, |i, o, ok| {
+            ffi::geocentric_forward_batch(i[0], i[1], n, o[0], o[1], o[2], ok);
+        });
+        let (outputs, ok) = match staged {
+            Ok(staged) => staged,
+            Err(e) => return batch_error(n, e),
+        };
+        let (x, y, z) = (&outputs[0], &outputs[1], &outputs[2]);
+
+        (0..n)
+            .map(|i| {
+                if ok[i] {
+                    Ok(XyzPoint {
+                        x: x[i] * M,
+                        y: y[i] * M,
+                        z: z[i] * M,
+                    })
+                } else {
+                    Err(GeographicError::UnknownException)
+                }
+            })
+            .collect()
+    }
+
+    pub fn geographiclib_version_str() -> String {
+        ffi::utf8_to_string(ffi::geographiclib_version())
+    }
+
+    pub fn compiler_version_str() -> String {
+        ffi::utf8_to_string(ffi::compiler_version())
+    }
+
+    /// Gets the instruction set the shim's batch kernels were dispatched to.
+    pub fn shim_cpu_features_str() -> String {
+        ffi::utf8_to_string(ffi::shim_cpu_features())
+    }
+
+    /// Turns the shim's probes on or off for the whole module.
+    pub fn shim_stats_enable(enabled: bool) {
+        ffi::shim_stats_enable(enabled)
+    }
+
+    /// Gets what the shim's probes have recorded.
+    ///
+    /// Only the entry points called in the module are recorded; the fallbacks
+    /// running here in Rust have no probes.
+    pub fn shim_stats_snapshot() -> Result<ShimStats> {
+        let size = size_of::<ShimStats>();
+        let block = ModuleHeap::alloc(size / 8, 0)?;
+        ffi::shim_stats_snapshot(block.f64_ptr(0));
+
+        let mut stats = ShimStats::default();
+        // SAFETY: ShimStats is made only of u64s, so any bytes are a valid
+        // value, and the module shares our little endian layout.
+        let bytes = unsafe {
+            std::slice::from_raw_parts_mut(&mut stats as *mut ShimStats as *mut u8, size)
+        };
+        bytes.copy_from_slice(&read_module_u8(block.f64_ptr(0), size)?);
+        Ok(stats)
+    }
+
+    /// Clears what the shim's probes have recorded.
+    pub fn shim_stats_reset() {
+        ffi::shim_stats_reset()
+    }
+
+    mod ffi {
+        use wasm_bindgen::prelude::*;
+
+        // Raw exports of the module's C functions, including the shim's batch
+        // entry points.  Pointer arguments and results are addresses in the
+        // module's own heap.
         #[wasm_bindgen]
         extern "C" {
-            #[wasm_bindgen(js_namespace = ["window", "GEO"])]
-            pub fn compiler_version() -> String;
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_malloc")]
+            pub fn malloc(size: usize) -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_free")]
+            pub fn free(ptr: usize);
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "UTF8ToString")]
+            pub fn utf8_to_string(ptr: usize) -> String;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geodesic_direct")]
+            pub fn geodesic_direct(
+                lat1: f64,
+                lon1: f64,
+                azi1: f64,
+                s12: f64,
+                lat2: usize,
+                lon2: usize,
+                a12: usize,
+            ) -> bool;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geodesic_inverse_with_azimuth")]
+            pub fn geodesic_inverse_with_azimuth(
+                lat1: f64,
+                lon1: f64,
+                lat2: f64,
+                lon2: f64,
+                s12: usize,
+                azi1: usize,
+                azi2: usize,
+                a12: usize,
+            ) -> bool;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geo_context_inverse_with_solver")]
+            pub fn geo_context_inverse_with_solver(
+                ctx: usize,
+                solver: u32,
+                lat1: f64,
+                lon1: f64,
+                lat2: f64,
+                lon2: f64,
+                s12: usize,
+                azi1: usize,
+                azi2: usize,
+                a12: usize,
+                path: usize,
+            ) -> bool;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geodesic_intercept")]
+            pub fn geodesic_intercept(
+                lat1: f64,
+                lon1: f64,
+                lat2: f64,
+                lon2: f64,
+                azi1: f64,
+                s12: f64,
+                latp: f64,
+                lonp: f64,
+                tolerance: f64,
+                max_iterations: u32,
+                lati: usize,
+                loni: usize,
+                spi: usize,
+                s1i: usize,
+                iterations: usize,
+            ) -> bool;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geocentric_forward")]
+            pub fn geocentric_forward(
+                lat: f64,
+                lon: f64,
+                h: f64,
+                x: usize,
+                y: usize,
+                z: usize,
+            ) -> bool;
+
+            // The version strings are static, so they're never freed.
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geographiclib_version")]
+            pub fn geographiclib_version() -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_compiler_version")]
+            pub fn compiler_version() -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_shim_cpu_features")]
+            pub fn shim_cpu_features() -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geodesic_polyline_inverse")]
+            pub fn geodesic_polyline_inverse(
+                latlon: usize,
+                n: usize,
+                s12: usize,
+                azi1: usize,
+                azi2: usize,
+                a12: usize,
+                cumulative: usize,
+                ok: usize,
+            ) -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geocentric_forward_batch")]
+            pub fn geocentric_forward_batch(
+                lat: usize,
+                lon: usize,
+                n: usize,
+                x: usize,
+                y: usize,
+                z: usize,
+                ok: usize,
+            ) -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geo_context_wgs84")]
+            pub fn geo_context_wgs84() -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_geo_context_route_store_new")]
+            pub fn geo_context_route_store_new(
+                ctx: usize,
+                solver: u32,
+                precision: u32,
+                cache: usize,
+                n_points: usize,
+            ) -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_route_store_free")]
+            pub fn route_store_free(store: usize);
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_route_store_load")]
+            pub fn route_store_load(
+                store: usize,
+                lat: usize,
+                lon: usize,
+                start: usize,
+                count: usize,
+            ) -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_route_store_finish")]
+            pub fn route_store_finish(store: usize);
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_route_store_indexed")]
+            pub fn route_store_indexed(store: usize) -> bool;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_route_store_view")]
+            pub fn route_store_view(store: usize, view: usize);
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_route_store_move_point")]
+            pub fn route_store_move_point(store: usize, i: usize, lat: f64, lon: f64) -> bool;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_route_store_match_segments")]
+            pub fn route_store_match_segments(
+                store: usize,
+                first_segment: usize,
+                n_segments: usize,
+                wlat: usize,
+                wlon: usize,
+                wx: usize,
+                wy: usize,
+                wz: usize,
+                n_waypoints: usize,
+                threshold: f64,
+                tolerance: f64,
+                max_iterations: u32,
+                capacity: usize,
+                waypoint: usize,
+                segment: usize,
+                lati: usize,
+                loni: usize,
+                spi: usize,
+                s1i: usize,
+                iterations: usize,
+                ok: usize,
+            ) -> usize;
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_shim_stats_enable")]
+            pub fn shim_stats_enable(enabled: bool);
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_shim_stats_snapshot")]
+            pub fn shim_stats_snapshot(stats: usize);
+
+            #[wasm_bindgen(js_namespace = ["window", "GEO"], js_name = "_shim_stats_reset")]
+            pub fn shim_stats_reset();
         }
     }
 }
@@ -507,10 +2693,16 @@ mod tests {
     use wasm_bindgen_test::wasm_bindgen_test;
 
     use super::{
-        geocentric_forward, geodesic_direct, geodesic_inverse, gnomonic_forward, gnomonic_reverse,
+        GeodesicCache, GeodesicCacheStats, GeodesicPath, GeodesicSolver, InterceptOptions,
+        PrefilterPrecision, ProbeStats, RouteSegmenter, RouteStore, ShimStats, WaypointColumns,
+        WaypointMatch, geocentric_forward, geocentric_forward_batch, geodesic_direct,
+        geodesic_intercept, geodesic_inverse, geodesic_inverse_with_solver,
+        geodesic_polyline_inverse, match_waypoints, match_waypoints_in_segments,
+        shim_cpu_features_str, shim_stats_enable, shim_stats_snapshot,
     };
+    use crate::algorithm::intercept_distance_floor;
     use crate::measure::DEG;
-    use crate::types::GeoPoint;
+    use crate::types::{GeoAndXyzPoint, GeoPoint, GeoSegment};
 
     // Some of the assertions below are commented as "taugological".  This means
     // that the value being asserted was derived by simply running the native, C
@@ -518,8 +2710,8 @@ mod tests {
     // against output from some other implementation like Mathematica.
     //
     // There wouldn't be much point to this on its own, but we can then run the
-    // same test in node with `jsffi` and verify the wasm-bindgen and embind
-    // bindings are correct.
+    // same test in node with `jsffi` and verify the wasm-bindgen bindings to
+    // the module's exports are correct.
 
     #[test]
     #[wasm_bindgen_test]
@@ -553,6 +2745,99 @@ mod tests {
         Ok(())
     }
 
+    // Not a wasm_bindgen_test, since the web module is built without the
+    // exact solver.
+    #[test]
+    fn test_geodesic_inverse_with_solver() -> Result<()> {
+        let point1 = GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?;
+        let point2 = GeoPoint::new(37.25612 * DEG, -122.19758 * DEG, None)?;
+        let series = geodesic_inverse(&point1, &point2)?;
+
+        let (auto, path) = geodesic_inverse_with_solver(&point1, &point2, GeodesicSolver::Auto)?;
+        assert_eq!(path, GeodesicPath::TangentPlane);
+        assert_relative_eq!(
+            auto.geo_distance,
+            series.geo_distance,
+            epsilon = 0.000_1 * M
+        );
+        assert_relative_eq!(auto.azimuth1, series.azimuth1, epsilon = 0.000_001);
+        assert_relative_eq!(auto.azimuth2, series.azimuth2, epsilon = 0.000_001);
+
+        let (exact, path) = geodesic_inverse_with_solver(&point1, &point2, GeodesicSolver::Exact)?;
+        assert_eq!(path, GeodesicPath::Exact);
+        assert_relative_eq!(
+            exact.geo_distance,
+            series.geo_distance,
+            epsilon = 0.000_001 * M
+        );
+
+        // Long segments, and short ones near the poles, fall back to the
+        // series solver.
+        let far = GeoPoint::new(5.0 * DEG, 5.0 * DEG, None)?;
+        let (_, path) = geodesic_inverse_with_solver(&point1, &far, GeodesicSolver::Auto)?;
+        assert_eq!(path, GeodesicPath::Series);
+        let polar1 = GeoPoint::new(89.0 * DEG, 0.0 * DEG, None)?;
+        let polar2 = GeoPoint::new(89.0001 * DEG, 0.0 * DEG, None)?;
+        let (_, path) = geodesic_inverse_with_solver(&polar1, &polar2, GeodesicSolver::Auto)?;
+        assert_eq!(path, GeodesicPath::Series);
+        Ok(())
+    }
+
+    // Not a wasm_bindgen_test, since the web build has no cache and only
+    // counts misses.
+    #[test]
+    fn test_geodesic_cache() -> Result<()> {
+        let point1 = GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?;
+        let point2 = GeoPoint::new(37.25997 * DEG, -122.18813 * DEG, None)?;
+        let cache = GeodesicCache::new(16)?;
+
+        // Misses and hits alike agree with the uncached solver.
+        let (uncached, _) = geodesic_inverse_with_solver(&point1, &point2, GeodesicSolver::Series)?;
+        for _ in 0..2 {
+            let (cached, path) = cache.inverse(&point1, &point2, GeodesicSolver::Series)?;
+            assert_eq!(cached.geo_distance, uncached.geo_distance);
+            assert_eq!(cached.azimuth1, uncached.azimuth1);
+            assert_eq!(cached.azimuth2, uncached.azimuth2);
+            assert_eq!(cached.arc_distance, uncached.arc_distance);
+            assert_eq!(path, GeodesicPath::Series);
+        }
+
+        // The reverse problem is answered by swapping the azimuths.
+        let reversed = geodesic_inverse(&point2, &point1)?;
+        let (cached, _) = cache.inverse(&point2, &point1, GeodesicSolver::Series)?;
+        assert_relative_eq!(
+            cached.geo_distance,
+            reversed.geo_distance,
+            epsilon = 0.000_001 * M
+        );
+        assert_relative_eq!(cached.azimuth1, reversed.azimuth1, epsilon = 0.000_000_001);
+        assert_relative_eq!(cached.azimuth2, reversed.azimuth2, epsilon = 0.000_000_001);
+
+        // Solutions from another solver aren't mistaken for the series one.
+        cache.inverse(&point1, &point2, GeodesicSolver::Exact)?;
+
+        let direct = geodesic_direct(&point1, uncached.azimuth1, 100.0 * M)?;
+        for _ in 0..2 {
+            let cached = cache.direct(&point1, uncached.azimuth1, 100.0 * M)?;
+            assert_eq!(cached.point2, direct.point2);
+            assert_eq!(cached.arc_distance, direct.arc_distance);
+        }
+
+        assert_eq!(
+            cache.stats(),
+            GeodesicCacheStats {
+                inverse_hits: 1,
+                inverse_reversed_hits: 1,
+                inverse_misses: 2,
+                direct_hits: 1,
+                direct_misses: 1,
+            }
+        );
+        assert_eq!(cache.stats().inverse_hit_rate(), 0.5);
+        assert!(GeodesicCache::new(0).is_err());
+        Ok(())
+    }
+
     #[test]
     #[wasm_bindgen_test]
     fn test_geodesic_direct() -> Result<()> {
@@ -576,44 +2861,492 @@ mod tests {
 
     #[test]
     #[wasm_bindgen_test]
-    fn test_gnomonic_forward() -> Result<()> {
-        let point0 = GeoPoint::new(20.0 * DEG, -40.0 * DEG, None)?;
-        let point = GeoPoint::new(17.0 * DEG, -35.0 * DEG, None)?;
+    fn test_geodesic_polyline_inverse() -> Result<()> {
+        let points = vec![
+            GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?,
+            GeoPoint::new(37.25997 * DEG, -122.18813 * DEG, None)?,
+            GeoPoint::new(37.26310 * DEG, -122.17985 * DEG, None)?,
+            GeoPoint::new(37.26924 * DEG, -122.18951 * DEG, None)?,
+        ];
+
+        let result = geodesic_polyline_inverse(&points);
+        assert_eq!(result.segments.len(), points.len() - 1);
+        assert_eq!(result.cumulative_distances.len(), points.len());
+        assert_eq!(result.cumulative_distances[0], 0.0 * M);
+        let mut distance = 0.0 * M;
+        for (i, segment) in result.segments.into_iter().enumerate() {
+            let segment = segment?;
+            let expected = geodesic_inverse(&points[i], &points[i + 1])?;
+            assert_eq!(segment.geo_distance, expected.geo_distance);
+            assert_eq!(segment.azimuth1, expected.azimuth1);
+            assert_eq!(segment.azimuth2, expected.azimuth2);
+            distance = distance + expected.geo_distance;
+            assert_relative_eq!(
+                result.cumulative_distances[i + 1],
+                distance,
+                max_relative = 0.000_000_001 * M
+            );
+        }
+
+        let single = geodesic_polyline_inverse(&points[..1]);
+        assert!(single.segments.is_empty());
+        assert_eq!(single.cumulative_distances, vec![0.0 * M]);
+        assert!(
+            geodesic_polyline_inverse(&[])
+                .cumulative_distances
+                .is_empty()
+        );
+        Ok(())
+    }
 
-        let result = gnomonic_forward(&point0, &point)?;
-        // point's longitude is east of point0's
-        assert!(result.x.value_unsafe > 0.0);
-        // point's latitude is south of point0's
-        assert!(result.y.value_unsafe < 0.0);
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_geocentric_forward() -> Result<()> {
+        let point = GeoPoint::new(15.0 * DEG, -40.0 * DEG, None)?;
+        let xyz_point = geocentric_forward(&point)?;
 
         // Tautological:
-        assert_relative_eq!(result.x, 534315.8196288919 * M, epsilon = 0.000_001 * M);
-        assert_relative_eq!(result.y, -325530.9051618818 * M, epsilon = 0.000_001 * M);
+        assert_relative_eq!(xyz_point.x, 4720510.708340171 * M, epsilon = 0.000_001 * M);
+        assert_relative_eq!(xyz_point.y, -3960978.794336638 * M, epsilon = 0.000_001 * M);
+        assert_relative_eq!(xyz_point.z, 1640100.1401958915 * M, epsilon = 0.000_001 * M);
         Ok(())
     }
 
     #[test]
     #[wasm_bindgen_test]
-    fn test_gnomonic_reverse() -> Result<()> {
-        let point0 = GeoPoint::new(20.0 * DEG, -40.0 * DEG, None)?;
-        let point = GeoPoint::new(17.0 * DEG, -35.0 * DEG, None)?;
+    fn test_geocentric_forward_batch() -> Result<()> {
+        let mut points = vec![
+            GeoPoint::new(90.0 * DEG, 0.0 * DEG, None)?,
+            GeoPoint::new(-90.0 * DEG, 180.0 * DEG, None)?,
+            GeoPoint::new(0.0 * DEG, -180.0 * DEG, None)?,
+            GeoPoint::new(45.0 * DEG, 135.0 * DEG, None)?,
+        ];
+        for i in 0..500 {
+            let t = i as f64;
+            points.push(GeoPoint::new(
+                (89.9 * (t * 0.7).sin()) * DEG,
+                (179.9 * (t * 1.3).cos()) * DEG,
+                None,
+            )?);
+        }
+
+        // The batch kernel's own sincos must agree with GeographicLib closely
+        // enough not to disturb the micrometer padding in
+        // intercept_distance_floor.
+        let results = geocentric_forward_batch(&points);
+        assert_eq!(results.len(), points.len());
+        for (point, result) in points.iter().zip(results) {
+            let result = result?;
+            let expected = geocentric_forward(point)?;
+            assert_relative_eq!(result.x, expected.x, epsilon = 0.000_000_01 * M);
+            assert_relative_eq!(result.y, expected.y, epsilon = 0.000_000_01 * M);
+            assert_relative_eq!(result.z, expected.z, epsilon = 0.000_000_01 * M);
+        }
 
-        let xypoint = gnomonic_forward(&point0, &point)?;
-        let result = gnomonic_reverse(&point0, &xypoint)?;
-        assert_relative_eq!(result, point);
+        assert!(geocentric_forward_batch(&[]).is_empty());
         Ok(())
     }
 
     #[test]
     #[wasm_bindgen_test]
-    fn test_geocentric_forward() -> Result<()> {
-        let point = GeoPoint::new(15.0 * DEG, -40.0 * DEG, None)?;
-        let xyz_point = geocentric_forward(&point)?;
+    fn test_shim_cpu_features() {
+        assert!(["generic", "avx2", "avx512"].contains(&shim_cpu_features_str().as_ref()));
+    }
 
-        // Tautological:
-        assert_relative_eq!(xyz_point.x, 4720510.708340171 * M, epsilon = 0.000_001 * M);
-        assert_relative_eq!(xyz_point.y, -3960978.794336638 * M, epsilon = 0.000_001 * M);
-        assert_relative_eq!(xyz_point.z, 1640100.1401958915 * M, epsilon = 0.000_001 * M);
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_route_store() -> Result<()> {
+        let route_points = [
+            GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?,
+            GeoPoint::new(37.25997 * DEG, -122.18813 * DEG, None)?,
+            GeoPoint::new(37.26310 * DEG, -122.17985 * DEG, None)?,
+            GeoPoint::new(37.26924 * DEG, -122.18951 * DEG, None)?,
+        ];
+        let route = RouteStore::new(
+            &route_points,
+            GeodesicSolver::Series,
+            PrefilterPrecision::Double,
+            None,
+        )?;
+        assert_eq!(route.num_points(), 4);
+        assert_eq!(route.num_segments(), 3);
+
+        let inverses = route_points
+            .windows(2)
+            .map(|pair| geodesic_inverse(&pair[0], &pair[1]))
+            .collect::<std::result::Result<Vec<_>, _>>()?;
+        let mut cumulative_distance = 0.0 * M;
+        for (i, point) in route_points.iter().enumerate() {
+            let xyz = route.xyz_point(i)?;
+            let expected = geocentric_forward(point)?;
+            assert_relative_eq!(xyz.x, expected.x, epsilon = 0.000_000_01 * M);
+            assert_relative_eq!(xyz.y, expected.y, epsilon = 0.000_000_01 * M);
+            assert_relative_eq!(xyz.z, expected.z, epsilon = 0.000_000_01 * M);
+            assert_relative_eq!(
+                route.cumulative_distance(i),
+                cumulative_distance,
+                epsilon = 0.000_001 * M
+            );
+            if let Some(inverse) = inverses.get(i) {
+                cumulative_distance = cumulative_distance + inverse.geo_distance;
+            }
+        }
+        for (i, inverse) in inverses.iter().enumerate() {
+            let segment = route.segment(i)?;
+            assert_eq!(segment.start_azimuth, inverse.azimuth1);
+            assert_eq!(segment.length, inverse.geo_distance);
+        }
+
+        // Loading reuses the sines and cosines of latitude from its geocentric
+        // conversion to solve short segments in the tangent plane, with the
+        // same results as solving them alone.
+        let short_points = [
+            GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?,
+            GeoPoint::new(37.25612 * DEG, -122.19758 * DEG, None)?,
+            GeoPoint::new(37.25660 * DEG, -122.19701 * DEG, None)?,
+        ];
+        let auto = RouteStore::new(
+            &short_points,
+            GeodesicSolver::Auto,
+            PrefilterPrecision::Double,
+            None,
+        )?;
+        for i in 0..auto.num_segments() {
+            let (inverse, path) = geodesic_inverse_with_solver(
+                &short_points[i],
+                &short_points[i + 1],
+                GeodesicSolver::Auto,
+            )?;
+            let segment = auto.segment(i)?;
+            assert_eq!(segment.path, GeodesicPath::TangentPlane);
+            assert_eq!(segment.path, path);
+            assert_eq!(segment.start_azimuth, inverse.azimuth1);
+            assert_eq!(segment.length, inverse.geo_distance);
+        }
+
+        let empty = RouteStore::new(
+            &[],
+            GeodesicSolver::Series,
+            PrefilterPrecision::Double,
+            None,
+        )?;
+        assert_eq!(empty.num_points(), 0);
+        assert_eq!(empty.num_segments(), 0);
+        Ok(())
+    }
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_route_segmenter() -> Result<()> {
+        let route_points = [
+            GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?,
+            GeoPoint::new(37.25997 * DEG, -122.18813 * DEG, Some(10.0 * M))?,
+            GeoPoint::new(37.26310 * DEG, -122.17985 * DEG, None)?,
+            GeoPoint::new(37.26924 * DEG, -122.18951 * DEG, None)?,
+        ];
+        let route = RouteStore::new(
+            &route_points,
+            GeodesicSolver::Series,
+            PrefilterPrecision::Double,
+            None,
+        )?;
+
+        // Segmenting in any chunking gives the same records as the store.
+        let mut segmenter = RouteSegmenter::new(GeodesicSolver::Series)?;
+        for chunks in [&[4][..], &[1, 0, 2, 1][..], &[1, 1, 1, 1][..]] {
+            let mut records = Vec::new();
+            let mut start = 0;
+            for &len in chunks {
+                segmenter.push(&route_points[start..start + len], &mut records);
+                start += len;
+            }
+            assert_eq!(records.len(), 3);
+            records.extend(segmenter.flush());
+            assert_eq!(records.len(), 4);
+
+            for (i, record) in records.iter().enumerate() {
+                assert_eq!(record.point, route_points[i]);
+                let xyz = record.xyz_point.unwrap();
+                let expected = route.xyz_point(i)?;
+                assert_relative_eq!(xyz.x, expected.x, epsilon = 0.000_000_01 * M);
+                assert_relative_eq!(xyz.y, expected.y, epsilon = 0.000_000_01 * M);
+                assert_relative_eq!(xyz.z, expected.z, epsilon = 0.000_000_01 * M);
+                assert_relative_eq!(
+                    record.cumulative_distance,
+                    route.cumulative_distance(i),
+                    epsilon = 0.000_001 * M
+                );
+                if i < 3 {
+                    assert_eq!(record.segment, Some(route.segment(i)?));
+                } else {
+                    assert_eq!(record.segment, None);
+                }
+            }
+        }
+
+        assert_eq!(segmenter.flush(), None);
+        Ok(())
+    }
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_match_waypoints() -> Result<()> {
+        let route_points = [
+            GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?,
+            GeoPoint::new(37.25997 * DEG, -122.18813 * DEG, None)?,
+            GeoPoint::new(37.26310 * DEG, -122.17985 * DEG, None)?,
+            GeoPoint::new(37.26924 * DEG, -122.18951 * DEG, None)?,
+        ];
+        let points = route_points
+            .iter()
+            .map(|p| GeoAndXyzPoint::try_from(*p))
+            .collect::<std::result::Result<Vec<_>, _>>()?;
+        let segments = route_points
+            .windows(2)
+            .map(|pair| geodesic_inverse(&pair[0], &pair[1]).map(|s| (s.azimuth1, s.geo_distance)))
+            .collect::<std::result::Result<Vec<_>, _>>()?;
+        let route = RouteStore::new(
+            &route_points,
+            GeodesicSolver::Series,
+            PrefilterPrecision::Double,
+            None,
+        )?;
+
+        let waypoints = [
+            // Beside the first segment
+            GeoPoint::new(37.25808 * DEG, -122.19315 * DEG, None)?,
+            // Beside the second segment
+            GeoPoint::new(37.26165 * DEG, -122.18399 * DEG, None)?,
+            // On the vertex joining the second and third segments
+            GeoPoint::new(37.26310 * DEG, -122.17985 * DEG, None)?,
+            // Far from the route
+            GeoPoint::new(37.30000 * DEG, -122.30000 * DEG, None)?,
+        ]
+        .into_iter()
+        .map(GeoAndXyzPoint::try_from)
+        .collect::<std::result::Result<Vec<_>, _>>()?;
+
+        // The engine should find exactly the intercepts we get by filtering
+        // every pair by its distance floor and solving the candidates.
+        let threshold = 35.0 * M;
+        let options = InterceptOptions::default();
+        let mut expected = Vec::new();
+        for (w, waypoint) in waypoints.iter().enumerate() {
+            for (s, (azimuth, length)) in segments.iter().enumerate() {
+                let segment = GeoSegment {
+                    start: &points[s],
+                    end: &points[s + 1],
+                    geo_length: *length,
+                    start_azimuth: *azimuth,
+                };
+                if intercept_distance_floor(&segment, waypoint)? > threshold {
+                    continue;
+                }
+                let interception = geodesic_intercept(
+                    &points[s].geo,
+                    &points[s + 1].geo,
+                    *azimuth,
+                    *length,
+                    &waypoint.geo,
+                    &options,
+                )?;
+                if interception.distance <= threshold {
+                    expected.push((w, s, interception));
+                }
+            }
+        }
+
+        let matches = match_waypoints(&route, &waypoints, threshold, &options);
+        assert_eq!(
+            matches
+                .iter()
+                .map(|m| (m.waypoint, m.segment))
+                .collect::<Vec<_>>(),
+            vec![(0, 0), (1, 1), (2, 1), (2, 2)]
+        );
+
+        // Filtering in single precision only loosens the floors, so the same
+        // candidates survive refinement.
+        let single = RouteStore::new(
+            &route_points,
+            GeodesicSolver::Series,
+            PrefilterPrecision::Single,
+            None,
+        )?;
+        assert_eq!(
+            match_waypoints(&single, &waypoints, threshold, &options)
+                .iter()
+                .map(|m| (m.waypoint, m.segment))
+                .collect::<Vec<_>>(),
+            vec![(0, 0), (1, 1), (2, 1), (2, 2)]
+        );
+        assert_eq!(matches.len(), expected.len());
+        for (m, (w, s, interception)) in matches.into_iter().zip(expected) {
+            assert_eq!((m.waypoint, m.segment), (w, s));
+            let result = m.interception?;
+            assert_eq!(result.point, interception.point);
+            assert_eq!(result.distance, interception.distance);
+            assert_eq!(result.offset, interception.offset);
+        }
+
+        assert!(match_waypoints(&route, &[], threshold, &options).is_empty());
+
+        // Nor should a route without segments, which has nothing to index.
+        let point_route = RouteStore::new(
+            &route_points[..1],
+            GeodesicSolver::Series,
+            PrefilterPrecision::Double,
+            None,
+        )?;
+        assert!(match_waypoints(&point_route, &waypoints, threshold, &options).is_empty());
+        Ok(())
+    }
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_route_store_move_point() -> Result<()> {
+        let route_points = [
+            GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?,
+            GeoPoint::new(37.25997 * DEG, -122.18813 * DEG, None)?,
+            GeoPoint::new(37.26310 * DEG, -122.17985 * DEG, None)?,
+            GeoPoint::new(37.26924 * DEG, -122.18951 * DEG, None)?,
+        ];
+        let waypoints = [
+            GeoPoint::new(37.25808 * DEG, -122.19315 * DEG, None)?,
+            GeoPoint::new(37.26165 * DEG, -122.18399 * DEG, None)?,
+            GeoPoint::new(37.26500 * DEG, -122.18200 * DEG, None)?,
+        ]
+        .into_iter()
+        .map(GeoAndXyzPoint::try_from)
+        .collect::<std::result::Result<Vec<_>, _>>()?;
+        let columns = WaypointColumns::from(&waypoints[..]);
+        let threshold = 35.0 * M;
+        let options = InterceptOptions::default();
+
+        for precision in [PrefilterPrecision::Double, PrefilterPrecision::Single] {
+            let mut route =
+                RouteStore::new(&route_points, GeodesicSolver::Series, precision, None)?;
+            let mut moved_points = route_points.to_vec();
+            // Moving the third point pulls the route past the third waypoint.
+            for (i, lat, lon) in [(2, 37.26480, -122.18190), (0, 37.25500, -122.19900)] {
+                moved_points[i] = GeoPoint::new(lat * DEG, lon * DEG, None)?;
+                route.move_point(i, &moved_points[i])?;
+
+                // The store should be just as if the moved route were loaded.
+                let fresh =
+                    RouteStore::new(&moved_points, GeodesicSolver::Series, precision, None)?;
+                for p in 0..route.num_points() {
+                    let (xyz, expected) = (route.xyz_point(p)?, fresh.xyz_point(p)?);
+                    assert_eq!((xyz.x, xyz.y, xyz.z), (expected.x, expected.y, expected.z));
+                    assert_eq!(route.cumulative_distance(p), fresh.cumulative_distance(p));
+                }
+                for s in 0..route.num_segments() {
+                    let (segment, expected) = (route.segment(s)?, fresh.segment(s)?);
+                    assert_eq!(segment.start_azimuth, expected.start_azimuth);
+                    assert_eq!(segment.length, expected.length);
+                }
+
+                // And so should its matches, on the moved segments and off.
+                let key = |m: WaypointMatch| -> Result<_> {
+                    Ok((m.waypoint, m.segment, m.interception?.distance))
+                };
+                let expected = match_waypoints(&fresh, &waypoints, threshold, &options)
+                    .into_iter()
+                    .map(key)
+                    .collect::<Result<Vec<_>>>()?;
+                let segments = i.saturating_sub(1)..i + 1;
+                let moved = match_waypoints_in_segments(
+                    &route,
+                    segments.clone(),
+                    &columns,
+                    threshold,
+                    &options,
+                )
+                .into_iter()
+                .map(key)
+                .collect::<Result<Vec<_>>>()?;
+                assert_eq!(
+                    moved,
+                    expected
+                        .iter()
+                        .copied()
+                        .filter(|(_, s, _)| segments.contains(s))
+                        .collect::<Vec<_>>()
+                );
+                let all = match_waypoints(&route, &waypoints, threshold, &options)
+                    .into_iter()
+                    .map(key)
+                    .collect::<Result<Vec<_>>>()?;
+                assert_eq!(all, expected);
+            }
+            assert!(
+                match_waypoints_in_segments(&route, 2..3, &columns, threshold, &options)
+                    .iter()
+                    .any(|m| m.waypoint == 2)
+            );
+        }
+        Ok(())
+    }
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_route_store_failed_move() -> Result<()> {
+        let route_points = [
+            GeoPoint::new(37.25579 * DEG, -122.19817 * DEG, None)?,
+            GeoPoint::new(37.25997 * DEG, -122.18813 * DEG, None)?,
+            GeoPoint::new(37.26310 * DEG, -122.17985 * DEG, None)?,
+        ];
+        let unconvertible = GeoPoint::new(f64::NAN * DEG, -122.18813 * DEG, None)?;
+
+        for precision in [PrefilterPrecision::Double, PrefilterPrecision::Single] {
+            let mut route =
+                RouteStore::new(&route_points, GeodesicSolver::Series, precision, None)?;
+            assert!(route.is_indexed());
+
+            // A point that can't be converted can't be placed in the index, so
+            // the route is scanned until the point is moved back.
+            assert!(route.move_point(1, &unconvertible).is_err());
+            assert!(!route.is_indexed());
+            route.move_point(1, &route_points[1])?;
+            assert!(route.is_indexed());
+
+            let fresh = RouteStore::new(&route_points, GeodesicSolver::Series, precision, None)?;
+            for p in 0..route.num_points() {
+                assert_eq!(route.cumulative_distance(p), fresh.cumulative_distance(p));
+            }
+        }
+        Ok(())
+    }
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_shim_stats() -> Result<()> {
+        // Other tests may be calling into the shim concurrently, so this only
+        // checks that our own calls are counted.
+        shim_stats_enable(true);
+        let before = shim_stats_snapshot()?;
+        let point = GeoPoint::new(0.0 * DEG, 0.0 * DEG, None)?;
+        for _ in 0..10 {
+            geodesic_direct(&point, 45.0 * DEG, 1000.0 * M)?;
+        }
+        let after = shim_stats_snapshot()?;
+
+        let direct = |stats: &ShimStats| stats.probes[1];
+        assert!(direct(&after).calls >= direct(&before).calls + 10);
+        assert!(direct(&after).nanoseconds >= direct(&before).nanoseconds);
+        assert!(after.iter().any(|(name, _)| name == "direct"));
+
+        let mut probe = ProbeStats {
+            calls: 4,
+            nanoseconds: 1700,
+            ..ProbeStats::default()
+        };
+        probe.histogram[6] = 3;
+        probe.histogram[10] = 1;
+        assert_eq!(probe.mean_nanoseconds(), 425.0);
+        assert_eq!(probe.quantile_nanoseconds(0.5), Some(128));
+        assert_eq!(probe.quantile_nanoseconds(0.99), Some(2048));
+        assert_eq!(ProbeStats::default().quantile_nanoseconds(0.5), None);
         Ok(())
     }
 }
@@ -10,8 +10,15 @@ use crate::GeoPoint;
 use crate::algorithm::{FromGeoPoints, intercept_distance_floor, karney_interception};
 pub use crate::fit::PROFILE_VERSION;
 use crate::geographic::geodesic_inverse;
-pub use crate::geographic::{compiler_version_str, geodesic_direct, geographiclib_version_str};
+pub use crate::geographic::{
+    ProbeStats, ShimStats, compiler_version_str, geodesic_direct, geographiclib_version_str,
+    shim_cpu_features_str, shim_stats_enable, shim_stats_reset, shim_stats_snapshot,
+};
 pub use crate::measure::{Kilometer, Mile};
+pub use crate::pipeline_bench::{
+    PIPELINE_SCALES, PipelineRun, PipelineScale, resample_track, run_pipeline, synthetic_track,
+    synthetic_waypoints,
+};
 use crate::types::{GeoAndXyzPoint, GeoSegment};
 
 /// Print debugging info about an intercept scenario
@@ -53,6 +60,9 @@ pub mod report {
     use dimensioned::si::Meter;
 
     use crate::ConversionInfo;
+    use crate::geographic::{
+        ShimStats, compiler_version_str, geographiclib_version_str, shim_cpu_features_str,
+    };
 
     pub fn conversion_report<T>(info: ConversionInfo) -> Result<String>
     where
@@ -107,4 +117,38 @@ pub mod report {
         }
         Ok(r)
     }
+
+    /// Formats what the shim's probes recorded as a table, one probe per row
+    ///
+    /// Times are shown in microseconds, with the median and 99th percentile
+    /// read off each probe's histogram as upper bounds.
+    pub fn shim_stats_report(stats: &ShimStats) -> Result<String> {
+        let mut r = String::new();
+        writeln!(
+            &mut r,
+            "Shim profile ({}, {}, {} kernels):\n",
+            geographiclib_version_str(),
+            compiler_version_str(),
+            shim_cpu_features_str()
+        )?;
+        writeln!(
+            &mut r,
+            "{:<20} {:>10} {:>12} {:>10} {:>10} {:>10}",
+            "probe", "calls", "total us", "mean us", "p50 us", "p99 us"
+        )?;
+        let us = |ns: Option<u64>| ns.map_or(f64::NAN, |ns| ns as f64 / 1e3);
+        for (name, probe) in stats.iter() {
+            writeln!(
+                &mut r,
+                "{:<20} {:>10} {:>12.1} {:>10.3} {:>10.3} {:>10.3}",
+                name,
+                probe.calls,
+                probe.nanoseconds as f64 / 1e3,
+                probe.mean_nanoseconds() / 1e3,
+                us(probe.quantile_nanoseconds(0.5)),
+                us(probe.quantile_nanoseconds(0.99)),
+            )?;
+        }
+        Ok(r)
+    }
 }
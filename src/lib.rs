@@ -56,6 +56,7 @@ mod gpx;
 #[doc(hidden)]
 pub mod internal;
 mod measure;
+mod pipeline_bench;
 mod point_type;
 mod types;
 
@@ -70,9 +71,10 @@ use tracing::{Level, debug, span};
 use crate::algorithm::AlgorithmError;
 use crate::course::{
     Course, CourseError, CoursePoint, CourseSet, CourseSetBuilder, CourseSetOptions,
+    GeodesicSolver, Record,
 };
 pub use crate::fit::{CourseFile, CoursePointType, Sport};
-use crate::geographic::GeographicError;
+use crate::geographic::{GeographicError, RouteSegmenter, SegmentRecord};
 use crate::gpx::{GpxItem, GpxReader};
 pub use crate::measure::{DEG, Degree};
 use crate::point_type::{GpxCreator, get_course_point_type, get_gpx_creator};
@@ -219,6 +221,88 @@ pub fn read_gpx<R: BufRead>(options: CourseSetOptions, gpx_input: R) -> Result<C
     Ok(builder.build()?)
 }
 
+/// The number of route points given to the segmenter at a time by
+/// [`segment_gpx`]
+const SEGMENTER_CHUNK_SIZE: usize = 1024;
+
+/// Segment a GPX file's route or track as it's read
+///
+/// Calls `f` with a [`Record`] for each route point in order, giving its
+/// cumulative distance along the route.  In contrast with [`read_gpx`], points
+/// are segmented a chunk at a time as they're parsed, and only the records of
+/// the current chunk are held, so memory use doesn't grow with the length of
+/// the route.  Waypoints are ignored.  Returns the number of records.
+///
+/// Segments are solved with `solver`.  As with [`read_gpx`], the GPX input is
+/// required to contain exactly one route or track, and repeated points are
+/// skipped.
+pub fn segment_gpx<R: BufRead, F: FnMut(Record)>(
+    gpx_input: R,
+    solver: GeodesicSolver,
+    mut f: F,
+) -> Result<usize> {
+    let span = span!(Level::DEBUG, "segment_input");
+    let _guard = span.enter();
+
+    fn emit<F: FnMut(Record)>(records: &mut Vec<SegmentRecord>, f: &mut F) -> Result<usize> {
+        let n = records.len();
+        for record in records.drain(..) {
+            if record.xyz_point.is_none() || !record.cumulative_distance.value_unsafe.is_finite() {
+                return Err(GeographicError::UnknownException.into());
+            }
+            f(Record {
+                point: record.point,
+                cumulative_distance: record.cumulative_distance,
+            });
+        }
+        Ok(n)
+    }
+
+    let mut segmenter = RouteSegmenter::new(solver)?;
+    let mut chunk = Vec::with_capacity(SEGMENTER_CHUNK_SIZE);
+    let mut records = Vec::with_capacity(SEGMENTER_CHUNK_SIZE);
+    let mut last_point = None;
+    let mut num_routes = 0usize;
+    let mut num_records = 0usize;
+    for item in GpxReader::from_reader(gpx_input) {
+        match item? {
+            GpxItem::TrackOrRoute => {
+                num_routes += 1;
+                if num_routes > 1 {
+                    return Err(CoursePointerError::CourseCount(num_routes));
+                }
+            }
+
+            GpxItem::TrackOrRoutePoint(p) => {
+                if num_routes == 0 {
+                    return Err(CoursePointerError::GpxOrder);
+                }
+                if last_point == Some(p) {
+                    continue;
+                }
+                last_point = Some(p);
+                chunk.push(p);
+                if chunk.len() == SEGMENTER_CHUNK_SIZE {
+                    segmenter.push(&chunk, &mut records);
+                    chunk.clear();
+                    num_records += emit(&mut records, &mut f)?;
+                }
+            }
+
+            _ => {}
+        }
+    }
+    if num_routes != 1 {
+        return Err(CoursePointerError::CourseCount(num_routes));
+    }
+
+    segmenter.push(&chunk, &mut records);
+    records.extend(segmenter.flush());
+    num_records += emit(&mut records, &mut f)?;
+    debug!("Segmented {} record(s)", num_records);
+    Ok(num_records)
+}
+
 /// Write a single [`Course`] into a GPX course file
 ///
 /// The `fit_speed` parameter sets a speed for placing timestamps along the FIT
@@ -233,3 +317,56 @@ pub fn write_fit_course<W: Write>(
     course_file.encode(fit_output)?;
     Ok(())
 }
+
+#[cfg(test)]
+mod tests {
+    use anyhow::Result;
+    use approx::assert_relative_eq;
+    use dimensioned::si::M;
+    use wasm_bindgen_test::wasm_bindgen_test;
+
+    use crate::course::{CourseSetOptions, GeodesicSolver};
+    use crate::pipeline_bench::synthetic_track;
+    use crate::{SEGMENTER_CHUNK_SIZE, read_gpx, segment_gpx};
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_segment_gpx() -> Result<()> {
+        // Long enough for several chunks, with a point repeated within the
+        // first chunk, and another repeated just after it's pushed, so that
+        // the repeat is only seen by comparing across chunks.
+        let track = synthetic_track(3 * SEGMENTER_CHUNK_SIZE)?;
+        let mut points = track.clone();
+        points.insert(SEGMENTER_CHUNK_SIZE, track[SEGMENTER_CHUNK_SIZE - 1]);
+        points.insert(10, track[10]);
+        let trkpts = points
+            .iter()
+            .map(|p| {
+                format!(
+                    "<trkpt lat=\"{}\" lon=\"{}\" />\n",
+                    p.lat().value_unsafe,
+                    p.lon().value_unsafe
+                )
+            })
+            .collect::<String>();
+        let gpx = format!("<gpx><trk><trkseg>\n{trkpts}</trkseg></trk></gpx>\n");
+
+        let options = CourseSetOptions::default().with_geodesic_solver(GeodesicSolver::Series);
+        let expected = read_gpx(options, gpx.as_bytes())?.courses.remove(0).records;
+        assert_eq!(expected.len(), track.len());
+
+        let mut records = Vec::new();
+        let n = segment_gpx(gpx.as_bytes(), GeodesicSolver::Series, |r| records.push(r))?;
+        assert_eq!(n, track.len());
+        assert_eq!(records.len(), expected.len());
+        for (record, expected) in records.iter().zip(&expected) {
+            assert_eq!(record.point, expected.point);
+            assert_relative_eq!(
+                record.cumulative_distance,
+                expected.cumulative_distance,
+                epsilon = 0.000_001 * M
+            );
+        }
+        Ok(())
+    }
+}
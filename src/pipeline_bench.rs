@@ -0,0 +1,333 @@
+//! A macro benchmark of the course building pipeline
+//!
+//! Scales a base track to any number of points, scatters waypoints along it,
+//! and times [`CourseSetBuilder::build`] on the result, recording what the
+//! shim's probes saw along the way.  The devtools `pipeline-bench` binary runs
+//! it natively on the RAGBRAI sample file, and an ignored test runs it in node
+//! on the jsffi build.  See `scripts/pipeline_bench.sh`.
+
+use std::fmt::Write;
+
+use crate::course::{CourseSetBuilder, CourseSetOptions};
+use crate::fit::CoursePointType;
+use crate::geographic::{ShimStats, shim_stats_enable, shim_stats_reset, shim_stats_snapshot};
+use crate::measure::DEG;
+use crate::types::GeoPoint;
+
+/// The size of a benchmark's inputs
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct PipelineScale {
+    pub points: usize,
+    pub waypoints: usize,
+}
+
+/// The default scaling curve, from an afternoon's ride to tracks far longer
+/// than any single GPX file we've been sent
+pub const PIPELINE_SCALES: [PipelineScale; 5] = [
+    PipelineScale {
+        points: 1_000,
+        waypoints: 10,
+    },
+    PipelineScale {
+        points: 10_000,
+        waypoints: 100,
+    },
+    PipelineScale {
+        points: 100_000,
+        waypoints: 1_000,
+    },
+    PipelineScale {
+        points: 1_000_000,
+        waypoints: 10_000,
+    },
+    PipelineScale {
+        points: 10_000_000,
+        waypoints: 100_000,
+    },
+];
+
+/// A small, deterministic generator so runs are comparable
+struct Lcg(u64);
+
+impl Lcg {
+    fn next_unit(&mut self) -> f64 {
+        self.0 = self
+            .0
+            .wrapping_mul(6364136223846793005)
+            .wrapping_add(1442695040888963407);
+        (self.0 >> 11) as f64 / (1u64 << 53) as f64
+    }
+}
+
+/// Resamples a track to `n` points spaced evenly along its point indices
+///
+/// Points are linearly interpolated in latitude and longitude between the base
+/// track's, so a longer track is a denser copy of the same ride, and a shorter
+/// one a sparser copy.  Tracks crossing the antimeridian aren't supported.
+///
+/// # Panics
+///
+/// If the base track or `n` has fewer than two points.
+pub fn resample_track(base: &[GeoPoint], n: usize) -> crate::Result<Vec<GeoPoint>> {
+    assert!(base.len() >= 2 && n >= 2);
+    let last = base.len() - 1;
+    (0..n)
+        .map(|i| -> crate::Result<GeoPoint> {
+            let t = i as f64 * last as f64 / (n - 1) as f64;
+            let k = (t as usize).min(last - 1);
+            let f = t - k as f64;
+            let (a, b) = (&base[k], &base[k + 1]);
+            let lat = a.lat().value_unsafe + f * (b.lat().value_unsafe - a.lat().value_unsafe);
+            let lon = a.lon().value_unsafe + f * (b.lon().value_unsafe - a.lon().value_unsafe);
+            Ok(GeoPoint::new(lat * DEG, lon * DEG, None)?)
+        })
+        .collect()
+}
+
+/// Scatters `n` waypoints near a track
+///
+/// Each is placed near a pseudo-random track point, offset by up to about 100
+/// meters in latitude and longitude, so that some fraction of them, depending
+/// on the threshold, become course points.
+pub fn synthetic_waypoints(track: &[GeoPoint], n: usize) -> crate::Result<Vec<GeoPoint>> {
+    const MAX_OFFSET_DEG: f64 = 0.001;
+    let mut rng = Lcg(0x5eed);
+    (0..n)
+        .map(|_| -> crate::Result<GeoPoint> {
+            let point = &track[(rng.next_unit() * track.len() as f64) as usize];
+            let lat = point.lat().value_unsafe + MAX_OFFSET_DEG * (2.0 * rng.next_unit() - 1.0);
+            let lon = point.lon().value_unsafe + MAX_OFFSET_DEG * (2.0 * rng.next_unit() - 1.0);
+            Ok(GeoPoint::new(lat * DEG, lon * DEG, None)?)
+        })
+        .collect()
+}
+
+/// A winding 100 km base track, for builds that can't read the sample files
+pub fn synthetic_track(n: usize) -> crate::Result<Vec<GeoPoint>> {
+    (0..n)
+        .map(|i| -> crate::Result<GeoPoint> {
+            let t = i as f64 / (n - 1).max(1) as f64;
+            let lat = 41.6 + 0.05 * (40.0 * t).sin() + 0.02 * (7.0 * t).cos();
+            let lon = -93.6 + 1.2 * t;
+            Ok(GeoPoint::new(lat * DEG, lon * DEG, None)?)
+        })
+        .collect()
+}
+
+/// The results of one benchmark run
+#[derive(Clone, Debug)]
+pub struct PipelineRun {
+    pub points: usize,
+    pub waypoints: usize,
+    pub course_points: usize,
+
+    /// Time spent building the course set, in seconds
+    pub seconds: f64,
+
+    /// What the shim's probes recorded while building, if they were on
+    pub stats: Option<ShimStats>,
+}
+
+impl PipelineRun {
+    pub fn points_per_second(&self) -> f64 {
+        self.points as f64 / self.seconds
+    }
+
+    pub fn waypoints_per_second(&self) -> f64 {
+        self.waypoints as f64 / self.seconds
+    }
+
+    /// The header row for [`PipelineRun::row`]
+    pub fn header() -> String {
+        format!(
+            "{:>10} {:>9} {:>8} {:>10} {:>12} {:>12}",
+            "points", "waypoints", "matched", "seconds", "points/s", "waypoints/s"
+        )
+    }
+
+    /// A table row summarizing the run
+    pub fn row(&self) -> String {
+        format!(
+            "{:>10} {:>9} {:>8} {:>10.3} {:>12.0} {:>12.0}",
+            self.points,
+            self.waypoints,
+            self.course_points,
+            self.seconds,
+            self.points_per_second(),
+            self.waypoints_per_second()
+        )
+    }
+
+    /// The probes that recorded any calls, one per line, with their share of
+    /// the run's time
+    pub fn probe_breakdown(&self) -> String {
+        let mut r = String::new();
+        for (name, probe) in self.stats.iter().flat_map(|stats| stats.iter()) {
+            let seconds = probe.nanoseconds as f64 / 1e9;
+            // Writing to a String can't fail.
+            let _ = writeln!(
+                &mut r,
+                "  {:<20} {:>10} calls {:>10.3} s {:>6.1}%",
+                name,
+                probe.calls,
+                seconds,
+                100.0 * seconds / self.seconds
+            );
+        }
+        r
+    }
+}
+
+/// Builds a course set from a track and waypoints, timing only the build
+///
+/// `clock` returns the current time in seconds, from whatever clock the
+/// platform has.  With `probes`, the shim's probes are reset and turned on for
+/// the build, and their stats returned in the run.
+pub fn run_pipeline<C: Fn() -> f64>(
+    track: &[GeoPoint],
+    waypoints: &[GeoPoint],
+    options: CourseSetOptions,
+    probes: bool,
+    clock: C,
+) -> crate::Result<PipelineRun> {
+    let mut builder = CourseSetBuilder::new(options);
+    let route = builder.add_route();
+    for point in track {
+        route.with_route_point(*point);
+    }
+    for (i, point) in waypoints.iter().enumerate() {
+        builder.add_waypoint(*point, CoursePointType::Generic, format!("Waypoint {i}"));
+    }
+
+    if probes {
+        shim_stats_reset();
+        shim_stats_enable(true);
+    }
+    let start = clock();
+    let course_set = builder.build();
+    let seconds = clock() - start;
+    let stats = if probes {
+        shim_stats_enable(false);
+        Some(shim_stats_snapshot()?)
+    } else {
+        None
+    };
+
+    Ok(PipelineRun {
+        points: track.len(),
+        waypoints: waypoints.len(),
+        course_points: course_set?.courses[0].course_points.len(),
+        seconds,
+        stats,
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use anyhow::Result;
+    use approx::assert_relative_eq;
+    use wasm_bindgen_test::wasm_bindgen_test;
+
+    use crate::course::CourseSetOptions;
+    use crate::measure::DEG;
+    use crate::pipeline_bench::{
+        resample_track, run_pipeline, synthetic_track, synthetic_waypoints,
+    };
+    use crate::types::GeoPoint;
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_resample_track() -> Result<()> {
+        let base = vec![
+            GeoPoint::new(40.0 * DEG, -100.0 * DEG, None)?,
+            GeoPoint::new(40.0 * DEG, -99.0 * DEG, None)?,
+            GeoPoint::new(41.0 * DEG, -99.0 * DEG, None)?,
+        ];
+
+        let dense = resample_track(&base, 5)?;
+        assert_eq!(dense.len(), 5);
+        assert_eq!(dense[0], base[0]);
+        assert_relative_eq!(dense[1].lon().value_unsafe, -99.5);
+        assert_eq!(dense[2], base[1]);
+        assert_relative_eq!(dense[3].lat().value_unsafe, 40.5);
+        assert_eq!(dense[4], base[2]);
+
+        let sparse = resample_track(&base, 2)?;
+        assert_eq!(sparse, vec![base[0], base[2]]);
+        Ok(())
+    }
+
+    #[test]
+    #[wasm_bindgen_test]
+    fn test_run_pipeline() -> Result<()> {
+        let track = resample_track(&synthetic_track(100)?, 1_000)?;
+        let waypoints = synthetic_waypoints(&track, 50)?;
+        let run = run_pipeline(
+            &track,
+            &waypoints,
+            CourseSetOptions::default(),
+            false,
+            || 0.0,
+        )?;
+        assert_eq!(run.points, 1_000);
+        assert_eq!(run.waypoints, 50);
+        assert!(run.course_points > 0 && run.course_points < 50);
+        assert!(run.stats.is_none());
+        Ok(())
+    }
+
+    // Run with `scripts/node_tests.sh --include-ignored bench_pipeline`.
+    #[cfg(feature = "jsffi")]
+    #[wasm_bindgen_test]
+    #[ignore]
+    fn bench_pipeline() -> Result<()> {
+        use js_sys::Reflect;
+        use wasm_bindgen::JsValue;
+        use wasm_bindgen_test::console_log;
+
+        use crate::pipeline_bench::{PIPELINE_SCALES, PipelineRun};
+
+        // Neither module's memory ever shrinks, so its size is how much it
+        // needed at its peak.
+        let memory_mib = |memory: &JsValue| {
+            Reflect::get(memory, &"buffer".into())
+                .and_then(|buffer| Reflect::get(&buffer, &"byteLength".into()))
+                .ok()
+                .and_then(|bytes| bytes.as_f64())
+                .map_or(f64::NAN, |bytes| bytes / (1 << 20) as f64)
+        };
+        let geo_memory = Reflect::get(&js_sys::global(), &"window".into())
+            .and_then(|window| Reflect::get(&window, &"GEO".into()))
+            .and_then(|geo| Reflect::get(&geo, &"wasmMemory".into()))
+            .unwrap_or(JsValue::UNDEFINED);
+
+        // The sample files can't be read from here, so the wasm base track is
+        // synthetic, with the RAGBRAI sample's number of points.
+        let base = synthetic_track(3_590)?;
+        console_log!(
+            "{}  {:>9} {:>9}",
+            PipelineRun::header(),
+            "rust MiB",
+            "geo MiB"
+        );
+        for scale in PIPELINE_SCALES.iter().take(4) {
+            let track = resample_track(&base, scale.points)?;
+            let waypoints = synthetic_waypoints(&track, scale.waypoints)?;
+            let run = run_pipeline(
+                &track,
+                &waypoints,
+                CourseSetOptions::default(),
+                true,
+                || js_sys::Date::now() / 1e3,
+            )?;
+            console_log!(
+                "{}  {:>9.1} {:>9.1}\n{}",
+                run.row(),
+                memory_mib(&wasm_bindgen::memory()),
+                memory_mib(&geo_memory),
+                run.probe_breakdown()
+            );
+        }
+        Ok(())
+    }
+}
@@ -10,16 +10,52 @@
 
 #include <GeographicLib/Config.h>
 
+#include <GeographicLib/Constants.hpp>
 #include <GeographicLib/Geocentric.hpp>
 #include <GeographicLib/Geodesic.hpp>
+#ifndef SHIM_NO_EXACT
+#include <GeographicLib/GeodesicExact.hpp>
+#endif
+#include <GeographicLib/GeodesicLine.hpp>
 #include <GeographicLib/Gnomonic.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
 #define STR_IMPL(x) #x
 #define STR(x) STR_IMPL(x)
 
+// Vectorized kernels are compiled once for each instruction set the shim
+// dispatches between, which needs their loops to be inlined into each
+// variant's entry point.
+#if defined(__GNUC__)
+#define KERNEL inline __attribute__((always_inline))
+#else
+#define KERNEL inline
+#endif
+
+// Only x86-64 has instruction sets beyond the baseline worth dispatching to,
+// and only GCC and Clang can compile variants for them in one translation
+// unit.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__EMSCRIPTEN__)
+#define SHIM_X86_DISPATCH
+#endif
+
+using GeographicLib::Constants;
 using GeographicLib::Geocentric;
 using GeographicLib::Geodesic;
+#ifndef SHIM_NO_EXACT
+using GeographicLib::GeodesicExact;
+#endif
+using GeographicLib::GeodesicLine;
 using GeographicLib::Gnomonic;
 
 namespace {
@@ -49,63 +85,2362 @@ const char* msvc_version(unsigned long full_ver) noexcept {
 
 #endif  // defined _MSC_FULL_VER
 
+/**
+ * `atanh(e) / e` for an eccentricity `e`, given `e2 = e * e`
+ *
+ * Sums the power series in `e2`, which unlike `std::atanh` can be evaluated
+ * at compile time.  Twenty terms are plenty for any ellipsoid with
+ * `e2 < 0.1`.
+ */
+constexpr double atanhee(double e2) noexcept {
+  double sum = 0.0, term = 1.0;
+  for (int k = 0; k < 20; ++k) {
+    sum += term / (2 * k + 1);
+    term *= e2;
+  }
+  return sum;
+}
+
 }  // namespace
 
-EXTERN bool geodesic_inverse_with_azimuth(double lat1, double lon1, double lat2,
-                                          double lon2, double* s12,
-                                          double* azi1, double* azi2,
-                                          double* a12) noexcept {
+/**
+ * An ellipsoid's shape, and the constants the shim's kernels derive from it
+ *
+ * Named like GeographicLib's own members: `n` is the third flattening, `e2`
+ * and `ep2` are the first and second eccentricities squared, `b` is the
+ * polar semi-axis, and `c2` is the square of the authalic radius.
+ */
+struct ellipsoid {
+  double a, f, n, e2, ep2, b, c2;
+
+  ellipsoid(double a, double f)
+      : a(a),
+        f(f),
+        n(f / (2 - f)),
+        e2(f * (2 - f)),
+        ep2(e2 / (1 - e2)),
+        b(a * (1 - f)),
+        c2((a * a + b * b * (e2 < 0.1 ? atanhee(e2)
+                                       : std::atanh(std::sqrt(e2)) /
+                                             std::sqrt(e2))) /
+           2) {}
+};
+
+/**
+ * The WGS84 ellipsoid as compile-time constants
+ *
+ * Kernels templated on their ellipsoid take this in place of an `ellipsoid`
+ * for the WGS84 context, which lets the compiler fold its constants into
+ * their arithmetic.  The derivations match `ellipsoid`'s, so both give the
+ * same results.
+ */
+struct wgs84_ellipsoid {
+  static constexpr double a = 6378137.0;
+  static constexpr double f = 1 / 298.257223563;
+  static constexpr double n = f / (2 - f);
+  static constexpr double e2 = f * (2 - f);
+  static constexpr double ep2 = e2 / (1 - e2);
+  static constexpr double b = a * (1 - f);
+  static constexpr double c2 = (a * a + b * b * atanhee(e2)) / 2;
+};
+
+/**
+ * An ellipsoid's solvers
+ *
+ * Members are only ever used through const methods, none of which touch
+ * shared mutable state, so a context can be used from any number of threads
+ * at once.
+ */
+struct geo_context {
+  ellipsoid shape;
+  Geodesic geodesic;
+#ifndef SHIM_NO_EXACT
+  GeodesicExact geodesic_exact;
+#endif
+  Gnomonic gnomonic;
+  Geocentric geocentric;
+
+  geo_context(double a, double f)
+      : shape(a, f),
+        geodesic(a, f),
+#ifndef SHIM_NO_EXACT
+        geodesic_exact(a, f),
+#endif
+        gnomonic(geodesic),
+        geocentric(a, f) {}
+};
+
+namespace {
+
+/**
+ * A route segment's geodesic, set up once for any number of queries
+ *
+ * Holds the segment's GeodesicLine, whose series coefficients make positions
+ * along it much cheaper than solving the direct problem from scratch, along
+ * with the segment's endpoints and the midpoint where interception starts.
+ * Immutable once built, like its context.
+ */
+struct segment_line {
+  const geo_context* ctx;
+  GeodesicLine line;
+  double lat1, lon1, lat2, lon2;
+  double latm, lonm;
+
+  segment_line() noexcept
+      : ctx(nullptr), lat1(0), lon1(0), lat2(0), lon2(0), latm(0), lonm(0) {}
+
+  segment_line(const geo_context* ctx, double lat1, double lon1, double lat2,
+               double lon2, double azi1, double s12)
+      : ctx(ctx),
+        line(ctx->geodesic.Line(lat1, lon1, azi1,
+                                Geodesic::LATITUDE | Geodesic::LONGITUDE |
+                                    Geodesic::DISTANCE_IN)),
+        lat1(lat1),
+        lon1(lon1),
+        lat2(lat2),
+        lon2(lon2) {
+    line.Position(s12 / 2, latm, lonm);
+  }
+};
+
+/**
+ * The WGS84 ellipsoid's context, shared by the context-free entry points
+ *
+ * This is constructed eagerly during static initialization, rather than in
+ * a function-local static, so that calls don't each pay for a static guard
+ * check.
+ */
+const geo_context wgs84(Constants::WGS84_a(), Constants::WGS84_f());
+
+/**
+ * Calls `f` with the shape of `ctx`'s ellipsoid, as compile-time constants
+ * when it's the WGS84 context
+ */
+template <typename F>
+auto with_shape(const geo_context* ctx, F&& f) {
+  return ctx == &wgs84 ? f(wgs84_ellipsoid{}) : f(ctx->shape);
+}
+
+bool all_finite(std::initializer_list<double> values) noexcept {
+  for (double value : values) {
+    if (!std::isfinite(value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint64_t bits_of(double x) noexcept {
+  uint64_t bits;
+  std::memcpy(&bits, &x, sizeof bits);
+  return bits;
+}
+
+/**
+ * Whether two inputs are the same, bit for bit
+ *
+ * This tells zeros of opposite signs apart, which GeographicLib does too.
+ */
+bool same(double x, double y) noexcept { return bits_of(x) == bits_of(y); }
+
+/**
+ * Runs a solver, skipping exception handling for finite inputs
+ *
+ * GeographicLib's solvers only throw from their constructors, which have all
+ * run by now, so finite inputs (which is all the typed Rust layer ever passes
+ * us) take a fast path without a try block.  Anything else keeps the guarded
+ * path, in case it trips over something we haven't anticipated.
+ */
+template <typename F>
+bool solve(bool inputs_finite, F&& f) noexcept {
+  if (inputs_finite) {
+    f();
+    return true;
+  }
   try {
-    static auto geodesic = Geodesic::WGS84();
-    *a12 = geodesic.Inverse(lat1, lon1, lat2, lon2, *s12, *azi1, *azi2);
+    f();
   } catch (...) {
     return false;
   }
   return true;
 }
 
-EXTERN bool geodesic_direct(double lat1, double lon1, double azi1, double s12,
-                            double* lat2, double* lon2, double* a12) noexcept {
+/** Whether the probes are recording, as set by `shim_stats_enable` */
+std::atomic<bool> stats_enabled{false};
+
+/**
+ * One thread stripe's counters for a probe, on cache lines of their own
+ *
+ * Counters have static storage, so they start out zeroed.
+ */
+struct alignas(64) probe_counters {
+  std::atomic<uint64_t> calls;
+  std::atomic<uint64_t> nanoseconds;
+  std::atomic<uint64_t> histogram[SHIM_STATS_BUCKETS];
+};
+
+/**
+ * The number of stripes the probes' counters are spread over
+ *
+ * Threads are dealt stripes in turn, so that a parallel conversion's workers
+ * mostly update counters of their own rather than contending for one set.
+ */
+constexpr size_t n_stats_stripes = 16;
+
+probe_counters stats_counters[n_stats_stripes][SHIM_STATS_N_PROBES];
+std::atomic<size_t> next_stats_stripe{0};
+
+/** The calling thread's stripe of counters */
+probe_counters* stats_stripe() noexcept {
+  thread_local const size_t stripe =
+      next_stats_stripe.fetch_add(1, std::memory_order_relaxed) %
+      n_stats_stripes;
+  return stats_counters[stripe];
+}
+
+/** The histogram bucket for a call lasting `ns` nanoseconds */
+size_t latency_bucket(uint64_t ns) noexcept {
+  if (ns < 2) {
+    return 0;
+  }
+#if defined(__GNUC__)
+  const size_t k = 63 - static_cast<size_t>(__builtin_clzll(ns));
+#else
+  size_t k = 0;
+  for (; ns > 1; ns >>= 1) {
+    ++k;
+  }
+#endif
+  return std::min(k, SHIM_STATS_BUCKETS - 1);
+}
+
+/**
+ * Times the rest of its scope, when the probes are recording, as a call to
+ * `probe`
+ *
+ * Uses the steady clock, which is `clock_gettime` on Linux and
+ * `QueryPerformanceCounter` on Windows; the time stamp counter would be
+ * cheaper to read, but isn't available on every target or comparable across
+ * cores.  Counters are updated with relaxed atomics.
+ */
+struct probe_timer {
+  shim_stats_probe probe;
+  bool enabled;
+  std::chrono::steady_clock::time_point start;
+
+  explicit probe_timer(shim_stats_probe probe) noexcept
+      : probe(probe), enabled(stats_enabled.load(std::memory_order_relaxed)) {
+    if (enabled) {
+      start = std::chrono::steady_clock::now();
+    }
+  }
+
+  probe_timer(const probe_timer&) = delete;
+  probe_timer& operator=(const probe_timer&) = delete;
+
+  ~probe_timer() {
+    if (!enabled) {
+      return;
+    }
+    constexpr auto relaxed = std::memory_order_relaxed;
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    const uint64_t ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    probe_counters& counters = stats_stripe()[probe];
+    counters.calls.fetch_add(1, relaxed);
+    counters.nanoseconds.fetch_add(ns, relaxed);
+    counters.histogram[latency_bucket(ns)].fetch_add(1, relaxed);
+  }
+};
+
+/**
+ * Computes the sines and cosines of `n` angles in degrees
+ *
+ * Unlike Math::sincosd this has no branches or library calls, so that the
+ * loop can be vectorized.  Each angle is reduced to within 45 degrees of a
+ * multiple of 90, where Taylor series through the 15th and 16th powers are
+ * accurate to within an ulp or so, and the quadrant is then applied with
+ * selects.  Rounding uses the 1.5 * 2^52 trick, which is exact for the
+ * magnitudes of latitude and longitude but relies on not compiling with
+ * -ffast-math.
+ */
+KERNEL void sincosd_n(const double* deg, size_t n, double* sinx,
+                      double* cosx) noexcept {
+  constexpr double round_magic = 6755399441055744.0;
+  constexpr double deg_to_rad = 0.017453292519943295;
+
+  for (size_t i = 0; i < n; ++i) {
+    double q = (deg[i] * (1.0 / 90.0) + round_magic) - round_magic;
+    double r = (deg[i] - 90.0 * q) * deg_to_rad;
+    double r2 = r * r;
+
+    double s =
+        r + r * r2 *
+                (-0.16666666666666666 +
+                 r2 * (0.008333333333333333 +
+                       r2 * (-0.0001984126984126984 +
+                             r2 * (2.7557319223985893e-06 +
+                                   r2 * (-2.505210838544172e-08 +
+                                         r2 * (1.6059043836821613e-10 +
+                                               r2 * -7.647163731819816e-13))))));
+    double c =
+        1.0 +
+        r2 * (-0.5 +
+              r2 * (0.041666666666666664 +
+                    r2 * (-0.001388888888888889 +
+                          r2 * (2.48015873015873e-05 +
+                                r2 * (-2.755731922398589e-07 +
+                                      r2 * (2.08767569878681e-09 +
+                                            r2 * (-1.1470745597729725e-11 +
+                                                  r2 * 4.779477332387385e-14)))))));
+
+    // k is q mod 4.  (q - 1.5) / 4 is never a tie, so rounding it gives
+    // floor(q / 4).
+    double k = q - 4.0 * (((q - 1.5) * 0.25 + round_magic) - round_magic);
+    sinx[i] = k == 0.0 ? s : k == 1.0 ? c : k == 2.0 ? -s : -c;
+    cosx[i] = k == 0.0 ? c : k == 1.0 ? -s : k == 2.0 ? -c : s;
+  }
+}
+
+}  // namespace
+
+EXTERN geo_context* geo_context_create(double a, double f) noexcept {
   try {
-    static auto geodesic = Geodesic::WGS84();
-    *a12 = geodesic.Direct(lat1, lon1, azi1, s12, *lat2, *lon2);
+    return new geo_context(a, f);
   } catch (...) {
-    return false;
+    return nullptr;
   }
-  return true;
 }
 
-EXTERN bool gnomonic_forward(double lat0, double lon0, double lat, double lon,
-                             double* x, double* y) noexcept {
+EXTERN void geo_context_destroy(geo_context* ctx) noexcept {
+  delete ctx;
+}
+
+EXTERN const geo_context* geo_context_wgs84() noexcept {
+  return &wgs84;
+}
+
+EXTERN bool geo_context_inverse(const geo_context* ctx, double lat1,
+                                double lon1, double lat2, double lon2,
+                                double* s12, double* azi1, double* azi2,
+                                double* a12) noexcept {
+  const probe_timer timer(SHIM_STATS_INVERSE);
+  return solve(all_finite({lat1, lon1, lat2, lon2}), [&] {
+    *a12 = ctx->geodesic.Inverse(lat1, lon1, lat2, lon2, *s12, *azi1, *azi2);
+  });
+}
+
+namespace {
+
+/**
+ * The longest segment, in meters, that `GEODESIC_AUTO` solves in the tangent
+ * plane
+ *
+ * Compared against Vincenty's solution on WGS84, the tangent plane's
+ * distances and the lateral offsets from its azimuths stay within about 40
+ * micrometers for segments up to this length within the latitude cutoff.
+ */
+constexpr double tangent_plane_max_length = 1000.0;
+
+/**
+ * The highest latitude, in degrees, at which `GEODESIC_AUTO` solves in the
+ * tangent plane
+ *
+ * The approximation's error grows like the tangent of the latitude squared,
+ * so by 89 degrees a kilometer long segment is off by millimeters.
+ */
+constexpr double tangent_plane_max_latitude = 80.0;
+
+/**
+ * Solves the inverse problem in the plane tangent to the ellipsoid at the
+ * segment's midpoint
+ *
+ * Scales the differences in latitude and longitude by the meridional and
+ * prime vertical radii of curvature at the midpoint, and turns the midpoint
+ * azimuth by half the meridian convergence to get the azimuth at either end.
+ * The arc length is approximated on a sphere of the midpoint's mean radius.
+ * Every output is NaN if any input is.
+ *
+ * The midpoint's latitude is found from the sines and cosines of the
+ * endpoints' latitudes, which route loading has already computed for their
+ * geocentric coordinates: the sums of the endpoints' sines and cosines point
+ * in the direction of the midpoint, scaled by the cosine of half the
+ * segment's difference in latitude, so they need only be normalized.
+ */
+template <typename E>
+void tangent_plane_inverse(const E& shape, double lat1, double lon1,
+                           double sphi1, double cphi1, double lat2,
+                           double lon2, double sphi2, double cphi2,
+                           double& s12, double& azi1, double& azi2,
+                           double& a12) {
+  using GeographicLib::Math;
+  const double a = shape.a;
+  const double e2 = shape.e2;
+
+  const double dphi = (lat2 - lat1) * Math::degree();
+  const double dlam = Math::AngDiff(lon1, lon2) * Math::degree();
+  const double ssum = sphi1 + sphi2, csum = cphi1 + cphi2;
+  const double norm = std::sqrt(ssum * ssum + csum * csum);
+  const double sphi = ssum / norm, cphi = csum / norm;
+  const double w2 = 1 - e2 * sphi * sphi;
+  const double n = a / std::sqrt(w2);
+  const double m = n * (1 - e2) / w2;
+
+  const double north = m * dphi, east = n * cphi * dlam;
+  const double azim = Math::atan2d(east, north);
+  const double convergence = dlam / 2 * sphi / Math::degree();
+  s12 = std::hypot(north, east);
+  azi1 = Math::AngNormalize(azim - convergence);
+  azi2 = Math::AngNormalize(azim + convergence);
+  a12 = s12 / std::sqrt(m * n) / Math::degree();
+}
+
+/**
+ * Solves the inverse problem with `solver`, as
+ * `geo_context_inverse_with_solver` does, given the sines and cosines of the
+ * endpoints' latitudes
+ *
+ * Only the tangent plane reads them, so they may be anything for other
+ * solvers.
+ */
+bool inverse_with_solver(const geo_context* ctx, geodesic_solver solver,
+                         double lat1, double lon1, double sphi1, double cphi1,
+                         double lat2, double lon2, double sphi2, double cphi2,
+                         double* s12, double* azi1, double* azi2, double* a12,
+                         geodesic_path* path) noexcept {
+  const probe_timer timer(SHIM_STATS_INVERSE);
+  if (solver == GEODESIC_AUTO &&
+      std::abs(lat1) <= tangent_plane_max_latitude &&
+      std::abs(lat2) <= tangent_plane_max_latitude) {
+    with_shape(ctx, [&](const auto& shape) {
+      tangent_plane_inverse(shape, lat1, lon1, sphi1, cphi1, lat2, lon2,
+                            sphi2, cphi2, *s12, *azi1, *azi2, *a12);
+    });
+    // Any NaN input fails this test, leaving the series solver to fail it.
+    if (*s12 <= tangent_plane_max_length) {
+      *path = GEODESIC_PATH_TANGENT_PLANE;
+      return true;
+    }
+  }
+
+  // Builds defining SHIM_NO_EXACT, such as the web app's, leave GeodesicExact
+  // out for size, and solve exact requests with the series solver below.
+#ifndef SHIM_NO_EXACT
+  if (solver == GEODESIC_EXACT) {
+    *path = GEODESIC_PATH_EXACT;
+    return solve(all_finite({lat1, lon1, lat2, lon2}), [&] {
+      *a12 = ctx->geodesic_exact.Inverse(lat1, lon1, lat2, lon2, *s12, *azi1,
+                                         *azi2);
+    });
+  }
+#endif
+  // Solved here rather than by geo_context_inverse, whose probe would count
+  // the call twice.
+  *path = GEODESIC_PATH_SERIES;
+  return solve(all_finite({lat1, lon1, lat2, lon2}), [&] {
+    *a12 = ctx->geodesic.Inverse(lat1, lon1, lat2, lon2, *s12, *azi1, *azi2);
+  });
+}
+
+}  // namespace
+
+EXTERN bool geo_context_inverse_with_solver(
+    const geo_context* ctx, geodesic_solver solver, double lat1, double lon1,
+    double lat2, double lon2, double* s12, double* azi1, double* azi2,
+    double* a12, geodesic_path* path) noexcept {
+  // The same sines and cosines as route loading's, so that a segment solves
+  // the same way whether it's solved alone or as part of a route.
+  double lat[2] = {lat1, lat2}, sphi[2] = {}, cphi[2] = {};
+  if (solver == GEODESIC_AUTO) {
+    sincosd_n(lat, 2, sphi, cphi);
+  }
+  return inverse_with_solver(ctx, solver, lat1, lon1, sphi[0], cphi[0], lat2,
+                             lon2, sphi[1], cphi[1], s12, azi1, azi2, a12,
+                             path);
+}
+
+EXTERN bool geo_context_direct(const geo_context* ctx, double lat1,
+                               double lon1, double azi1, double s12,
+                               double* lat2, double* lon2,
+                               double* a12) noexcept {
+  const probe_timer timer(SHIM_STATS_DIRECT);
+  return solve(all_finite({lat1, lon1, azi1, s12}), [&] {
+    *a12 = ctx->geodesic.Direct(lat1, lon1, azi1, s12, *lat2, *lon2);
+  });
+}
+
+EXTERN size_t geo_context_polyline_inverse(const geo_context* ctx,
+                                           const double* latlon, size_t n,
+                                           double* s12, double* azi1,
+                                           double* azi2, double* a12,
+                                           double* cumulative,
+                                           bool* ok) noexcept {
+  const probe_timer timer(SHIM_STATS_POLYLINE_INVERSE);
+  if (n == 0) {
+    return 0;
+  }
+
+  size_t num_ok = 0;
+  double distance = 0.0;
+  cumulative[0] = distance;
+  for (size_t i = 0; i + 1 < n; ++i) {
+    const double* p1 = latlon + 2 * i;
+    const double* p2 = p1 + 2;
+    ok[i] = geo_context_inverse(ctx, p1[0], p1[1], p2[0], p2[1], &s12[i],
+                                &azi1[i], &azi2[i], &a12[i]);
+    if (ok[i]) {
+      ++num_ok;
+      distance += s12[i];
+    } else {
+      distance = std::numeric_limits<double>::quiet_NaN();
+    }
+    cumulative[i + 1] = distance;
+  }
+  return num_ok;
+}
+
+EXTERN bool geo_context_gnomonic_forward(const geo_context* ctx, double lat0,
+                                         double lon0, double lat, double lon,
+                                         double* x, double* y) noexcept {
+  return solve(all_finite({lat0, lon0, lat, lon}), [&] {
+    ctx->gnomonic.Forward(lat0, lon0, lat, lon, *x, *y);
+  });
+}
+
+EXTERN bool geo_context_gnomonic_reverse(const geo_context* ctx, double lat0,
+                                         double lon0, double x, double y,
+                                         double* lat, double* lon) noexcept {
+  return solve(all_finite({lat0, lon0, x, y}), [&] {
+    ctx->gnomonic.Reverse(lat0, lon0, x, y, *lat, *lon);
+  });
+}
+
+namespace {
+
+/**
+ * Solves the interception problem between a geodesic segment and a point
+ *
+ * This follows Karney's suggested approach: Starting from the segment's
+ * midpoint, repeatedly project the segment and the point onto a gnomonic
+ * projection centered on the current guess, find the intercept with 2D
+ * geometry, and re-center on the result.  See karney_interception in
+ * algorithm.rs for references.
+ */
+void intercept(const segment_line& segment, double latp, double lonp,
+               double tolerance, unsigned max_iterations, double* lati,
+               double* loni, double* spi, double* s1i, unsigned* iterations) {
+  const probe_timer timer(SHIM_STATS_INTERCEPT);
+  const Geodesic& geodesic = segment.ctx->geodesic;
+  const Gnomonic& gnomonic = segment.ctx->gnomonic;
+  const double lat1 = segment.lat1, lon1 = segment.lon1;
+  const double lat2 = segment.lat2, lon2 = segment.lon2;
+
+  double lat = segment.latm, lon = segment.lonm;
+  unsigned i = 0;
+  while (i < max_iterations) {
+    double x1, y1, x2, y2, xp, yp;
+    gnomonic.Forward(lat, lon, lat1, lon1, x1, y1);
+    gnomonic.Forward(lat, lon, lat2, lon2, x2, y2);
+    gnomonic.Forward(lat, lon, latp, lonp, xp, yp);
+
+    // b is the projected segment and a runs from its start to the point.
+    // Project a onto b, clamping to the segment's endpoints.
+    double bx = x2 - x1, by = y2 - y1;
+    double ax = xp - x1, ay = yp - y1;
+    double ab = ax * bx + ay * by;
+    double bb = bx * bx + by * by;
+    double vx = 0.0, vy = 0.0;
+    if (!(ab <= 0.0)) {
+      vx = bx * (ab / bb);
+      vy = by * (ab / bb);
+      if (vx * vx + vy * vy >= bb) {
+        vx = bx;
+        vy = by;
+      }
+    }
+
+    // The projection is centered on the current estimate, so the distance
+    // of the new estimate from the origin is how far this iteration moved
+    // it.
+    double dx = x1 + vx, dy = y1 + vy;
+    gnomonic.Reverse(lat, lon, dx, dy, lat, lon);
+    ++i;
+    if (std::hypot(dx, dy) <= tolerance) {
+      break;
+    }
+  }
+  *iterations = i;
+
+  geodesic.Inverse(latp, lonp, lat, lon, *spi);
+  geodesic.Inverse(lat1, lon1, lat, lon, *s1i);
+  *lati = lat;
+  *loni = lon;
+}
+
+/**
+ * Solves the interception problem between a segment and each of `n` finite
+ * points, as `intercept` does for one
+ *
+ * The points are iterated in lockstep, a block at a time, and the segment's
+ * endpoints are only projected about centers that haven't been seen recently.
+ * Every point's first center is the segment's midpoint, and points beyond the
+ * same end of the segment all clamp to the same estimate, so in a cluster of
+ * waypoints most of those projections are shared.  Centers are only shared
+ * when they're bit for bit the same, so results are exactly those of
+ * `intercept`.
+ */
+void intercept_n(const segment_line& segment, const double* latp,
+                 const double* lonp, size_t n, double tolerance,
+                 unsigned max_iterations, double* lati, double* loni,
+                 double* spi, double* s1i, unsigned* iterations) {
+  const probe_timer timer(SHIM_STATS_INTERCEPT_N);
+  const Geodesic& geodesic = segment.ctx->geodesic;
+  const Gnomonic& gnomonic = segment.ctx->gnomonic;
+  const double lat1 = segment.lat1, lon1 = segment.lon1;
+  const double lat2 = segment.lat2, lon2 = segment.lon2;
+
+  // The segment's endpoints projected about recent centers, replaced round
+  // robin.
+  struct projected_segment {
+    double lat, lon;
+    double x1, y1, x2, y2;
+  };
+  constexpr size_t num_projections = 8;
+  projected_segment projections[num_projections];
+  size_t num_projected = 0, next_projection = 0;
+  auto project = [&](double lat, double lon) -> const projected_segment& {
+    for (size_t k = 0; k < num_projected; ++k) {
+      if (same(projections[k].lat, lat) &&
+          same(projections[k].lon, lon)) {
+        return projections[k];
+      }
+    }
+    projected_segment& p = projections[next_projection];
+    next_projection = (next_projection + 1) % num_projections;
+    num_projected = std::min(num_projected + 1, num_projections);
+    p.lat = lat;
+    p.lon = lon;
+    gnomonic.Forward(lat, lon, lat1, lon1, p.x1, p.y1);
+    gnomonic.Forward(lat, lon, lat2, lon2, p.x2, p.y2);
+    return p;
+  };
+
+  constexpr size_t block_size = 64;
+  for (size_t start = 0; start < n; start += block_size) {
+    const size_t m = std::min(block_size, n - start);
+    size_t active[block_size];
+    size_t num_active = m;
+    for (size_t k = 0; k < m; ++k) {
+      active[k] = start + k;
+      lati[start + k] = segment.latm;
+      loni[start + k] = segment.lonm;
+      iterations[start + k] = 0;
+    }
+
+    for (unsigned i = 0; i < max_iterations && num_active > 0; ++i) {
+      size_t still_active = 0;
+      for (size_t k = 0; k < num_active; ++k) {
+        const size_t j = active[k];
+        const double lat = lati[j], lon = loni[j];
+        const projected_segment& p = project(lat, lon);
+        double xp, yp;
+        gnomonic.Forward(lat, lon, latp[j], lonp[j], xp, yp);
+
+        // As in intercept.
+        double bx = p.x2 - p.x1, by = p.y2 - p.y1;
+        double ax = xp - p.x1, ay = yp - p.y1;
+        double ab = ax * bx + ay * by;
+        double bb = bx * bx + by * by;
+        double vx = 0.0, vy = 0.0;
+        if (!(ab <= 0.0)) {
+          vx = bx * (ab / bb);
+          vy = by * (ab / bb);
+          if (vx * vx + vy * vy >= bb) {
+            vx = bx;
+            vy = by;
+          }
+        }
+
+        double dx = p.x1 + vx, dy = p.y1 + vy;
+        gnomonic.Reverse(lat, lon, dx, dy, lati[j], loni[j]);
+        ++iterations[j];
+        if (!(std::hypot(dx, dy) <= tolerance)) {
+          active[still_active++] = j;
+        }
+      }
+      num_active = still_active;
+    }
+
+    for (size_t j = start; j < start + m; ++j) {
+      geodesic.Inverse(latp[j], lonp[j], lati[j], loni[j], spi[j]);
+      geodesic.Inverse(lat1, lon1, lati[j], loni[j], s1i[j]);
+    }
+  }
+}
+
+}  // namespace
+
+EXTERN bool geo_context_intercept(const geo_context* ctx, double lat1,
+                                  double lon1, double lat2, double lon2,
+                                  double azi1, double s12, double latp,
+                                  double lonp, double tolerance,
+                                  unsigned max_iterations, double* lati,
+                                  double* loni, double* spi, double* s1i,
+                                  unsigned* iterations) noexcept {
+  const bool inputs_finite =
+      all_finite({lat1, lon1, lat2, lon2, azi1, s12, latp, lonp});
+  return solve(inputs_finite, [&] {
+    const segment_line segment(ctx, lat1, lon1, lat2, lon2, azi1, s12);
+    intercept(segment, latp, lonp, tolerance, max_iterations, lati, loni, spi,
+              s1i, iterations);
+  });
+}
+
+namespace {
+
+/**
+ * Solves the interception problem between a prepared segment and a point, as
+ * `geo_context_intercept` does
+ */
+bool guarded_intercept(const segment_line& segment, double latp, double lonp,
+                       double tolerance, unsigned max_iterations, double* lati,
+                       double* loni, double* spi, double* s1i,
+                       unsigned* iterations) noexcept {
+  return solve(all_finite({latp, lonp}), [&] {
+    intercept(segment, latp, lonp, tolerance, max_iterations, lati, loni, spi,
+              s1i, iterations);
+  });
+}
+
+/**
+ * Solves the interception problem between a prepared segment and each of `n`
+ * points, as `guarded_intercept` does for one
+ *
+ * `ok[i]` is set to whether the i-th solution succeeded, and the number of
+ * successes is returned.  Finite points are solved together by `intercept_n`.
+ */
+size_t guarded_intercept_n(const segment_line& segment, const double* latp,
+                           const double* lonp, size_t n, double tolerance,
+                           unsigned max_iterations, double* lati, double* loni,
+                           double* spi, double* s1i, unsigned* iterations,
+                           bool* ok) noexcept {
+  bool inputs_finite = true;
+  for (size_t i = 0; i < n && inputs_finite; ++i) {
+    inputs_finite = all_finite({latp[i], lonp[i]});
+  }
+  if (inputs_finite) {
+    intercept_n(segment, latp, lonp, n, tolerance, max_iterations, lati, loni,
+                spi, s1i, iterations);
+    std::fill(ok, ok + n, true);
+    return n;
+  }
+
+  // Anything else takes the guarded path a point at a time.
+  size_t num_ok = 0;
+  for (size_t i = 0; i < n; ++i) {
+    ok[i] = guarded_intercept(segment, latp[i], lonp[i], tolerance,
+                              max_iterations, &lati[i], &loni[i], &spi[i],
+                              &s1i[i], &iterations[i]);
+    num_ok += ok[i];
+  }
+  return num_ok;
+}
+
+/**
+ * The greatest depth below the surface of an ellipsoid with semi-axes `a` and
+ * `b` that a chord of squared length `bb` can reach
+ */
+double max_chord_depth(double a, double b, double bb) noexcept {
+  return a * (1.0 - std::sqrt(1.0 - bb / (4.0 * b * b)));
+}
+
+/**
+ * Lower bounds on the geodesic distances between a point and `n` segments
+ *
+ * Mirrors intercept_distance_floor in algorithm.rs: each bound is the point's
+ * distance from a segment's chord, less the chord's maximum depth `depth[i]`
+ * and a micrometer of padding.  Segment `i` runs from point `i` to point
+ * `i + 1` of `x`, `y`, and `z`.  The clamp to the chord's endpoints is written
+ * as selects, so that the loop can be vectorized.
+ *
+ * `T` is `double`, or `float` for the single precision prefilter, whose
+ * rounding error is left to its callers to bound.
+ */
+template <typename T>
+KERNEL void intercept_distance_floor_n(const T* x, const T* y, const T* z,
+                                       const T* depth, size_t n, T xp, T yp,
+                                       T zp, T* floor) noexcept {
+  for (size_t i = 0; i < n; ++i) {
+    T bx = x[i + 1] - x[i], by = y[i + 1] - y[i], bz = z[i + 1] - z[i];
+    T ax = xp - x[i], ay = yp - y[i], az = zp - z[i];
+    T ab = ax * bx + ay * by + az * bz;
+    T bb = bx * bx + by * by + bz * bz;
+    // A NaN from a zero-length chord selects its start.
+    T t = ab / bb;
+    t = t > T(0) ? t : T(0);
+    t = t < T(1) ? t : T(1);
+
+    T dx = ax - t * bx, dy = ay - t * by, dz = az - t * bz;
+    floor[i] =
+        std::sqrt(dx * dx + dy * dy + dz * dz) - (depth[i] + T(0.000001));
+  }
+}
+
+/**
+ * Flags which of up to 64 segments might be within `threshold` of a point
+ *
+ * Sets bit `i` of the result for each segment whose distance floor isn't
+ * greater than the threshold, including those with NaN floors.
+ */
+template <typename T>
+KERNEL uint64_t intercept_floor_mask_64(const T* x, const T* y, const T* z,
+                                        const T* depth, size_t n, T xp, T yp,
+                                        T zp, T threshold) noexcept {
+  T floor[64];
+  intercept_distance_floor_n(x, y, z, depth, n, xp, yp, zp, floor);
+  uint64_t mask = 0;
+  for (size_t i = 0; i < n; ++i) {
+    mask |= static_cast<uint64_t>(!(floor[i] > threshold)) << i;
+  }
+  return mask;
+}
+
+/** The most points `geocentric_block` converts at once */
+constexpr size_t geocentric_block_size = 256;
+
+/**
+ * Converts up to `geocentric_block_size` points on the surface of the
+ * ellipsoid `shape` to geocentric coordinates
+ *
+ * The sines and cosines of the points' latitudes are left in `sphi` and
+ * `cphi`, for the segments between them.  Each step is a simple loop over
+ * scratch space on the stack, which the compiler can vectorize.  Latitudes
+ * outside [-90, 90] give NaNs.
+ */
+template <typename E>
+KERNEL void geocentric_block(const E& shape, const double* lat,
+                             const double* lon, size_t m, double* x,
+                             double* y, double* z, double* sphi,
+                             double* cphi) noexcept {
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  double phi[geocentric_block_size];
+  double slam[geocentric_block_size], clam[geocentric_block_size];
+
+  for (size_t i = 0; i < m; ++i) {
+    phi[i] = std::abs(lat[i]) <= 90.0 ? lat[i] : nan;
+  }
+  sincosd_n(phi, m, sphi, cphi);
+  sincosd_n(lon, m, slam, clam);
+  for (size_t i = 0; i < m; ++i) {
+    double nu = shape.a / std::sqrt(1 - shape.e2 * sphi[i] * sphi[i]);
+    x[i] = nu * cphi[i] * clam[i];
+    y[i] = nu * cphi[i] * slam[i];
+    z[i] = nu * (1 - shape.e2) * sphi[i];
+  }
+}
+
+/**
+ * The vectorized kernels, as compiled for one instruction set
+ *
+ * The build turns off floating point contraction, so that variants whose
+ * instruction sets include FMA still round exactly as the baseline does and
+ * results don't depend on the CPU.
+ */
+struct kernel_set {
+  const char* name;
+  void (*geocentric_wgs84)(const double* lat, const double* lon, size_t m,
+                           double* x, double* y, double* z, double* sphi,
+                           double* cphi) noexcept;
+  void (*geocentric)(const ellipsoid& shape, const double* lat,
+                     const double* lon, size_t m, double* x, double* y,
+                     double* z, double* sphi, double* cphi) noexcept;
+  uint64_t (*floor_mask)(const double* x, const double* y, const double* z,
+                         const double* depth, size_t n, double xp, double yp,
+                         double zp, double threshold) noexcept;
+  uint64_t (*single_floor_mask)(const float* x, const float* y,
+                                const float* z, const float* depth, size_t n,
+                                float xp, float yp, float zp,
+                                float threshold) noexcept;
+};
+
+// Defines NAME_kernels, a kernel_set compiled with the given function
+// attributes.
+#define DEFINE_KERNEL_SET(NAME, ATTRIBUTES)                                   \
+  ATTRIBUTES void NAME##_geocentric_wgs84(                                    \
+      const double* lat, const double* lon, size_t m, double* x, double* y,   \
+      double* z, double* sphi, double* cphi) noexcept {                       \
+    geocentric_block(wgs84_ellipsoid{}, lat, lon, m, x, y, z, sphi, cphi);    \
+  }                                                                           \
+  ATTRIBUTES void NAME##_geocentric(                                          \
+      const ellipsoid& shape, const double* lat, const double* lon, size_t m, \
+      double* x, double* y, double* z, double* sphi, double* cphi) noexcept { \
+    geocentric_block(shape, lat, lon, m, x, y, z, sphi, cphi);                \
+  }                                                                           \
+  ATTRIBUTES uint64_t NAME##_floor_mask(                                      \
+      const double* x, const double* y, const double* z, const double* depth, \
+      size_t n, double xp, double yp, double zp, double threshold) noexcept { \
+    return intercept_floor_mask_64(x, y, z, depth, n, xp, yp, zp, threshold); \
+  }                                                                           \
+  ATTRIBUTES uint64_t NAME##_single_floor_mask(                               \
+      const float* x, const float* y, const float* z, const float* depth,     \
+      size_t n, float xp, float yp, float zp, float threshold) noexcept {     \
+    return intercept_floor_mask_64(x, y, z, depth, n, xp, yp, zp, threshold); \
+  }                                                                           \
+  const kernel_set NAME##_kernels = {#NAME, NAME##_geocentric_wgs84,          \
+                                     NAME##_geocentric, NAME##_floor_mask,    \
+                                     NAME##_single_floor_mask};
+
+DEFINE_KERNEL_SET(generic, )
+#ifdef SHIM_X86_DISPATCH
+DEFINE_KERNEL_SET(avx2, __attribute__((target("avx2"))))
+DEFINE_KERNEL_SET(avx512,
+                  __attribute__((target("avx512f,avx512dq,avx512vl"))))
+#endif
+
+#undef DEFINE_KERNEL_SET
+
+/** Picks the kernels for the CPU the process is running on */
+const kernel_set& select_kernels() noexcept {
+#ifdef SHIM_X86_DISPATCH
+  // __builtin_cpu_supports can otherwise be called before libgcc has
+  // initialized its CPU model, since this runs from a static initializer.
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512dq") &&
+      __builtin_cpu_supports("avx512vl")) {
+    return avx512_kernels;
+  }
+  if (__builtin_cpu_supports("avx2")) {
+    return avx2_kernels;
+  }
+#endif
+  return generic_kernels;
+}
+
+/** The kernels in use, chosen once during static initialization */
+const kernel_set& kernels = select_kernels();
+
+/**
+ * Converts up to `geocentric_block_size` points to geocentric coordinates
+ * with the kernels in use, as `geo_context_geocentric_forward_batch` does
+ *
+ * Also leaves the sines and cosines of the points' latitudes in `sphi` and
+ * `cphi`, so that the segments joining them needn't compute them again.
+ * Returns the number of points converted.
+ */
+size_t geocentric_vertices(const geo_context* ctx, const double* lat,
+                           const double* lon, size_t m, double* x, double* y,
+                           double* z, double* sphi, double* cphi,
+                           bool* ok) noexcept {
+  if (ctx == &wgs84) {
+    kernels.geocentric_wgs84(lat, lon, m, x, y, z, sphi, cphi);
+  } else {
+    kernels.geocentric(ctx->shape, lat, lon, m, x, y, z, sphi, cphi);
+  }
+
+  size_t num_ok = 0;
+  for (size_t i = 0; i < m; ++i) {
+    ok[i] = std::isfinite(x[i]) & std::isfinite(y[i]) & std::isfinite(z[i]);
+    num_ok += ok[i];
+  }
+  return num_ok;
+}
+
+/** The index of the lowest set bit of a nonzero mask */
+size_t lowest_bit(uint64_t mask) noexcept {
+#if defined(__GNUC__)
+  return static_cast<size_t>(__builtin_ctzll(mask));
+#else
+  size_t i = 0;
+  for (; (mask & 1) == 0; mask >>= 1) {
+    ++i;
+  }
+  return i;
+#endif
+}
+
+/**
+ * A route's segment chords, for the double precision prefilter
+ */
+struct double_chords {
+  const double *x, *y, *z, *depth;
+
+  /**
+   * Flags which of up to 64 segments starting at segment `start` might be
+   * within `threshold` of the point `p`, as `intercept_floor_mask_64` does
+   */
+  uint64_t mask_64(size_t start, size_t n, const double* p,
+                   double threshold) const noexcept {
+    return kernels.floor_mask(x + start, y + start, z + start, depth + start,
+                              n, p[0], p[1], p[2], threshold);
+  }
+};
+
+/**
+ * The factor by which the single precision prefilter's rounding error may
+ * exceed the size of the problem
+ *
+ * With `u` the unit roundoff of `float`, rounding the coordinates relative to
+ * the origin moves the point by at most `u * |p|` and each chord by at most
+ * `u * extent`, and a first order analysis of the floor's arithmetic bounds
+ * its error by about `11 * u * (|p| + 3 * extent)`.  This allows `32 * u`,
+ * leaving a wide margin for the higher order terms and for the conversion of
+ * the threshold itself.
+ */
+constexpr double single_floor_error =
+    16 * static_cast<double>(std::numeric_limits<float>::epsilon());
+
+/**
+ * A route's segment chords in single precision, for the single precision
+ * prefilter
+ *
+ * The coordinates are relative to `origin`, with no route point further than
+ * `extent` from it, and the depths are rounded up.
+ */
+struct single_chords {
+  double origin[3];
+  double extent;
+  const float *x, *y, *z, *depth;
+
+  /**
+   * Flags up to 64 segments as `double_chords::mask_64` does, raising the
+   * threshold by the bound on the floors' rounding error so that no segment
+   * it flags is missed
+   */
+  uint64_t mask_64(size_t start, size_t n, const double* p,
+                   double threshold) const noexcept {
+    const double xp = p[0] - origin[0], yp = p[1] - origin[1],
+                 zp = p[2] - origin[2];
+    const double slack =
+        single_floor_error * (std::sqrt(xp * xp + yp * yp + zp * zp) +
+                              3 * extent + std::abs(threshold));
+    return kernels.single_floor_mask(
+        x + start, y + start, z + start, depth + start, n,
+        static_cast<float>(xp), static_cast<float>(yp),
+        static_cast<float>(zp), static_cast<float>(threshold + slack));
+  }
+};
+
+/**
+ * An axis-aligned box in geocentric coordinates
+ */
+struct Box {
+  double lo[3];
+  double hi[3];
+
+  static Box empty() noexcept {
+    constexpr double inf = std::numeric_limits<double>::infinity();
+    return Box{{inf, inf, inf}, {-inf, -inf, -inf}};
+  }
+
+  void extend(const Box& other) noexcept {
+    for (int i = 0; i < 3; ++i) {
+      lo[i] = std::min(lo[i], other.lo[i]);
+      hi[i] = std::max(hi[i], other.hi[i]);
+    }
+  }
+
+  double center(int axis) const noexcept { return (lo[axis] + hi[axis]) / 2; }
+
+  /** Whether `p` lies within `radius` of the box */
+  bool near(const double* p, double radius) const noexcept {
+    return p[0] >= lo[0] - radius && p[0] <= hi[0] + radius &&
+           p[1] >= lo[1] - radius && p[1] <= hi[1] + radius &&
+           p[2] >= lo[2] - radius && p[2] <= hi[2] + radius;
+  }
+};
+
+/**
+ * The box around segment `s`'s chord, padded by its depth so that it holds
+ * the geodesic, on an ellipsoid with semi-axes `a` and `b`
+ */
+Box segment_box(double a, double b, const double* x, const double* y,
+                const double* z, size_t s) noexcept {
+  const double dx = x[s + 1] - x[s], dy = y[s + 1] - y[s],
+               dz = z[s + 1] - z[s];
+  const double pad =
+      max_chord_depth(a, b, dx * dx + dy * dy + dz * dz) + 0.000001;
+  return Box{{std::min(x[s], x[s + 1]) - pad, std::min(y[s], y[s + 1]) - pad,
+              std::min(z[s], z[s + 1]) - pad},
+             {std::max(x[s], x[s + 1]) + pad, std::max(y[s], y[s + 1]) + pad,
+              std::max(z[s], z[s + 1]) + pad}};
+}
+
+}  // namespace
+
+struct route_index {
+  /**
+   * A node of the hierarchy
+   *
+   * Leaves have a nonzero `count` of segments, listed in `order` starting at
+   * `start`.  Interior nodes are followed immediately by their first child,
+   * and `start` is the index of their second.
+   */
+  struct Node {
+    Box box;
+    size_t start;
+    size_t count;
+  };
+
+  static constexpr size_t leaf_size = 4;
+
+  std::vector<Node> nodes;
+  std::vector<size_t> order;
+  std::vector<Box> boxes;
+
+  /** Each node's parent and each segment's leaf, once a refit needs them */
+  std::vector<size_t> parent, leaf;
+
+  /**
+   * Builds the subtree over `order[begin, end)`, returning its index
+   *
+   * Splits at the median segment along the axis in which the segments'
+   * centers are most spread out.
+   */
+  size_t build(size_t begin, size_t end) {
+    const size_t index = nodes.size();
+    nodes.push_back(Node{Box::empty(), begin, end - begin});
+
+    Box bounds = Box::empty();
+    Box centers = Box::empty();
+    for (size_t i = begin; i < end; ++i) {
+      const Box& box = boxes[order[i]];
+      bounds.extend(box);
+      const double c[3] = {box.center(0), box.center(1), box.center(2)};
+      centers.extend(Box{{c[0], c[1], c[2]}, {c[0], c[1], c[2]}});
+    }
+    nodes[index].box = bounds;
+    if (end - begin <= leaf_size) {
+      return index;
+    }
+
+    int axis = 0;
+    for (int i = 1; i < 3; ++i) {
+      if (centers.hi[i] - centers.lo[i] > centers.hi[axis] - centers.lo[axis]) {
+        axis = i;
+      }
+    }
+    const size_t mid = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + mid,
+                     order.begin() + end, [&](size_t s, size_t t) {
+                       return boxes[s].center(axis) < boxes[t].center(axis);
+                     });
+    build(begin, mid);
+    size_t second = build(mid, end);
+    nodes[index].start = second;
+    nodes[index].count = 0;
+    return index;
+  }
+
+  /**
+   * Calls `f` with each segment whose box lies within `radius` of `p`
+   */
+  template <typename F>
+  void visit(const double* p, double radius, F&& f) const {
+    if (nodes.empty()) {
+      return;
+    }
+    // The tree is balanced, so its depth is well within the stack's size.
+    size_t stack[64];
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const size_t i = stack[--top];
+      const Node& node = nodes[i];
+      if (!node.box.near(p, radius)) {
+        continue;
+      }
+      if (node.count > 0) {
+        for (size_t j = node.start; j < node.start + node.count; ++j) {
+          if (boxes[order[j]].near(p, radius)) {
+            f(order[j]);
+          }
+        }
+      } else {
+        stack[top++] = node.start;
+        stack[top++] = i + 1;
+      }
+    }
+  }
+
+  /**
+   * Replaces segment `s`'s box, refitting the boxes of the nodes above it
+   *
+   * The tree keeps its shape, so queries stay correct but visit more nodes
+   * the further segments move from where they were split.  Throws if the
+   * maps from segments to leaves can't be allocated.
+   */
+  void refit(size_t s, const Box& box) {
+    if (leaf.empty()) {
+      parent.assign(nodes.size(), 0);
+      leaf.resize(boxes.size());
+      for (size_t i = 0; i < nodes.size(); ++i) {
+        const Node& node = nodes[i];
+        if (node.count > 0) {
+          for (size_t j = node.start; j < node.start + node.count; ++j) {
+            leaf[order[j]] = i;
+          }
+        } else {
+          parent[i + 1] = parent[node.start] = i;
+        }
+      }
+    }
+
+    boxes[s] = box;
+    size_t i = leaf[s];
+    Box bounds = Box::empty();
+    for (size_t j = nodes[i].start; j < nodes[i].start + nodes[i].count; ++j) {
+      bounds.extend(boxes[order[j]]);
+    }
+    nodes[i].box = bounds;
+    while (i != 0) {
+      i = parent[i];
+      bounds = nodes[i + 1].box;
+      bounds.extend(nodes[nodes[i].start].box);
+      nodes[i].box = bounds;
+    }
+  }
+};
+
+EXTERN route_index* geo_context_route_index_new(const geo_context* ctx,
+                                                const double* x,
+                                                const double* y,
+                                                const double* z,
+                                                size_t n_points) noexcept {
+  if (n_points < 2) {
+    return nullptr;
+  }
+  // A box around a non-finite point would never be visited by a query, and
+  // its center would break the ordering the build partitions by.
+  for (size_t i = 0; i < n_points; ++i) {
+    if (!(std::isfinite(x[i]) && std::isfinite(y[i]) && std::isfinite(z[i]))) {
+      return nullptr;
+    }
+  }
+  const double a = ctx->shape.a;
+  const double b = ctx->shape.b;
+  const size_t n_segments = n_points - 1;
+
   try {
-    static auto gnomonic = Gnomonic(Geodesic::WGS84());
-    gnomonic.Forward(lat0, lon0, lat, lon, *x, *y);
+    auto index = new route_index;
+    index->boxes.reserve(n_segments);
+    index->order.reserve(n_segments);
+    for (size_t s = 0; s < n_segments; ++s) {
+      index->boxes.push_back(segment_box(a, b, x, y, z, s));
+      index->order.push_back(s);
+    }
+    index->nodes.reserve(2 * (n_segments / route_index::leaf_size) + 1);
+    index->build(0, n_segments);
+    return index;
   } catch (...) {
-    return false;
+    return nullptr;
   }
-  return true;
 }
 
-EXTERN bool gnomonic_reverse(double lat0, double lon0, double x, double y,
-                             double* lat, double* lon) noexcept {
+EXTERN void route_index_free(route_index* index) noexcept {
+  delete index;
+}
+
+EXTERN size_t route_index_query(const route_index* index, double x, double y,
+                                double z, double radius, size_t capacity,
+                                size_t* segments) noexcept {
+  const double p[3] = {x, y, z};
+  size_t num_segments = 0;
+  index->visit(p, radius, [&](size_t s) {
+    if (num_segments < capacity) {
+      segments[num_segments] = s;
+    }
+    ++num_segments;
+  });
+  return num_segments;
+}
+
+EXTERN void geo_context_chord_depths(const geo_context* ctx, const double* x,
+                                     const double* y, const double* z,
+                                     size_t n_points, double* depth) noexcept {
+  with_shape(ctx, [&](const auto& shape) {
+    for (size_t s = 0; s + 1 < n_points; ++s) {
+      const double dx = x[s + 1] - x[s], dy = y[s + 1] - y[s],
+                   dz = z[s + 1] - z[s];
+      depth[s] =
+          max_chord_depth(shape.a, shape.b, dx * dx + dy * dy + dz * dz);
+    }
+  });
+}
+
+EXTERN size_t intercept_floor_mask(const double* x, const double* y,
+                                   const double* z, const double* depth,
+                                   size_t n_points, double xp, double yp,
+                                   double zp, double threshold,
+                                   uint64_t* mask) noexcept {
+  const size_t n_segments = n_points < 2 ? 0 : n_points - 1;
+  size_t num_set = 0;
+  for (size_t start = 0; start < n_segments; start += 64) {
+    const size_t m = std::min<size_t>(64, n_segments - start);
+    uint64_t bits = kernels.floor_mask(x + start, y + start, z + start,
+                                       depth + start, m, xp, yp, zp, threshold);
+    mask[start / 64] = bits;
+    for (; bits != 0; bits &= bits - 1) {
+      ++num_set;
+    }
+  }
+  return num_set;
+}
+
+namespace {
+
+/**
+ * Matches waypoints against a route as `geo_context_match_waypoints` does,
+ * filtering its segments with `chords`, a `double_chords` or `single_chords`
+ */
+template <typename Chords>
+size_t match_waypoints(
+    const geo_context* ctx, const route_index* index, const double* lat,
+    const double* lon, const double* azi1, const double* s12,
+    const Chords& chords, size_t n_points, const double* wlat,
+    const double* wlon, const double* wx, const double* wy, const double* wz,
+    size_t n_waypoints, double threshold, double tolerance,
+    unsigned max_iterations, size_t capacity, size_t* waypoint,
+    size_t* segment, double* lati, double* loni, double* spi, double* s1i,
+    unsigned* iterations, bool* ok) noexcept {
+  const probe_timer timer(SHIM_STATS_MATCH_WAYPOINTS);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  const size_t n_segments = n_points < 2 ? 0 : n_points - 1;
+
+  // Records an interception if it's within the threshold, or if it failed.
+  size_t num_matches = 0;
+  auto record = [&](size_t w, size_t s, double mlat, double mlon, double mspi,
+                    double ms1i, unsigned miterations, bool mok) {
+    if (mok && mspi > threshold) {
+      return;
+    }
+
+    if (num_matches < capacity) {
+      waypoint[num_matches] = w;
+      segment[num_matches] = s;
+      lati[num_matches] = mlat;
+      loni[num_matches] = mlon;
+      spi[num_matches] = mspi;
+      s1i[num_matches] = ms1i;
+      iterations[num_matches] = miterations;
+      ok[num_matches] = mok;
+    }
+    ++num_matches;
+  };
+
+  // Calls `f(w, s)` for each segment whose floor is within the threshold of
+  // a waypoint, ordered by waypoint and then by segment.
+  std::vector<size_t> candidates;
+  auto for_each_candidate = [&](auto&& f) {
+    for (size_t w = 0; w < n_waypoints; ++w) {
+      // The index can't place non-finite points or distances, which get the
+      // linear scan so that they fail just as they would without an index.
+      const double p[3] = {wx[w], wy[w], wz[w]};
+      bool indexed = false;
+      if (index != nullptr && all_finite({wx[w], wy[w], wz[w]}) &&
+          !std::isnan(threshold)) {
+        try {
+          candidates.clear();
+          index->visit(p, threshold,
+                       [&](size_t s) { candidates.push_back(s); });
+          std::sort(candidates.begin(), candidates.end());
+          indexed = true;
+        } catch (...) {
+        }
+      }
+
+      if (indexed) {
+        for (size_t s : candidates) {
+          if (chords.mask_64(s, 1, p, threshold) != 0) {
+            f(w, s);
+          }
+        }
+      } else {
+        for (size_t start = 0; start < n_segments; start += 64) {
+          const size_t m = std::min<size_t>(64, n_segments - start);
+          for (uint64_t bits = chords.mask_64(start, m, p, threshold);
+               bits != 0; bits &= bits - 1) {
+            f(w, start + lowest_bit(bits));
+          }
+        }
+      }
+    }
+  };
+
+  // Dense clusters of waypoints each run into the same segments, so the
+  // candidates are gathered first and solved a segment at a time, building
+  // each segment's line once and letting its waypoints share projections
+  // (see intercept_n).  They're then recorded in their original order.
+  struct candidate {
+    size_t waypoint, segment;
+  };
+  std::vector<candidate> pairs;
+  std::vector<size_t> order, rank;
+  std::vector<double> plat, plon, rlat, rlon, rspi, rs1i;
+  std::vector<unsigned> riterations;
+  std::unique_ptr<bool[]> rok;
+  bool grouped = true;
   try {
-    static auto gnomonic = Gnomonic(Geodesic::WGS84());
-    gnomonic.Reverse(lat0, lon0, x, y, *lat, *lon);
+    for_each_candidate([&](size_t w, size_t s) { pairs.push_back({w, s}); });
+    const size_t n = pairs.size();
+    order.resize(n);
+    rank.resize(n);
+    for (auto* v : {&plat, &plon, &rlat, &rlon, &rspi, &rs1i}) {
+      v->resize(n);
+    }
+    riterations.resize(n);
+    rok.reset(new bool[n]);
   } catch (...) {
-    return false;
+    grouped = false;
   }
-  return true;
+
+  if (grouped) {
+    const size_t n = pairs.size();
+    for (size_t q = 0; q < n; ++q) {
+      order[q] = q;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+      return pairs[a].segment < pairs[b].segment;
+    });
+    for (size_t j = 0; j < n; ++j) {
+      rank[order[j]] = j;
+      plat[j] = wlat[pairs[order[j]].waypoint];
+      plon[j] = wlon[pairs[order[j]].waypoint];
+    }
+
+    for (size_t j = 0; j < n;) {
+      const size_t s = pairs[order[j]].segment;
+      size_t end = j + 1;
+      while (end < n && pairs[order[end]].segment == s) {
+        ++end;
+      }
+      if (all_finite(
+              {lat[s], lon[s], lat[s + 1], lon[s + 1], azi1[s], s12[s]})) {
+        const segment_line line(ctx, lat[s], lon[s], lat[s + 1], lon[s + 1],
+                                azi1[s], s12[s]);
+        guarded_intercept_n(line, &plat[j], &plon[j], end - j, tolerance,
+                            max_iterations, &rlat[j], &rlon[j], &rspi[j],
+                            &rs1i[j], &riterations[j], &rok[j]);
+      } else {
+        for (size_t k = j; k < end; ++k) {
+          rlat[k] = rlon[k] = rspi[k] = rs1i[k] = nan;
+          riterations[k] = 0;
+          rok[k] = geo_context_intercept(
+              ctx, lat[s], lon[s], lat[s + 1], lon[s + 1], azi1[s], s12[s],
+              plat[k], plon[k], tolerance, max_iterations, &rlat[k], &rlon[k],
+              &rspi[k], &rs1i[k], &riterations[k]);
+        }
+      }
+      j = end;
+    }
+
+    for (size_t q = 0; q < n; ++q) {
+      const size_t j = rank[q];
+      record(pairs[q].waypoint, pairs[q].segment, rlat[j], rlon[j], rspi[j],
+             rs1i[j], riterations[j], rok[j]);
+    }
+    return num_matches;
+  }
+
+  // Without room to gather the candidates, each is solved as it's found.
+  // Nearby waypoints tend to share segments, so recently used segments' lines
+  // are kept in a small direct-mapped cache rather than rebuilt per pair.
+  constexpr size_t cache_size = 16;
+  segment_line lines[cache_size];
+  size_t cached[cache_size];
+  std::fill(cached, cached + cache_size, n_segments);
+
+  for_each_candidate([&](size_t w, size_t s) {
+    double mlat = nan, mlon = nan, mspi = nan, ms1i = nan;
+    unsigned miterations = 0;
+    bool mok;
+    if (!all_finite(
+            {lat[s], lon[s], lat[s + 1], lon[s + 1], azi1[s], s12[s]})) {
+      mok = geo_context_intercept(
+          ctx, lat[s], lon[s], lat[s + 1], lon[s + 1], azi1[s], s12[s],
+          wlat[w], wlon[w], tolerance, max_iterations, &mlat, &mlon, &mspi,
+          &ms1i, &miterations);
+    } else {
+      const size_t slot = s % cache_size;
+      if (cached[slot] != s) {
+        lines[slot] = segment_line(ctx, lat[s], lon[s], lat[s + 1], lon[s + 1],
+                                   azi1[s], s12[s]);
+        cached[slot] = s;
+      }
+      mok = guarded_intercept(lines[slot], wlat[w], wlon[w], tolerance,
+                              max_iterations, &mlat, &mlon, &mspi, &ms1i,
+                              &miterations);
+    }
+    record(w, s, mlat, mlon, mspi, ms1i, miterations, mok);
+  });
+  return num_matches;
 }
 
-EXTERN bool geocentric_forward(double lat, double lon, double h, double* x,
-                               double* y, double* z) noexcept {
+}  // namespace
+
+EXTERN size_t geo_context_match_waypoints(
+    const geo_context* ctx, const route_index* index, const double* lat,
+    const double* lon, const double* x, const double* y, const double* z,
+    const double* azi1, const double* s12, const double* depth,
+    size_t n_points, const double* wlat, const double* wlon, const double* wx,
+    const double* wy, const double* wz, size_t n_waypoints, double threshold,
+    double tolerance, unsigned max_iterations, size_t capacity,
+    size_t* waypoint, size_t* segment, double* lati, double* loni, double* spi,
+    double* s1i, unsigned* iterations, bool* ok) noexcept {
+  return match_waypoints(ctx, index, lat, lon, azi1, s12,
+                         double_chords{x, y, z, depth}, n_points, wlat, wlon,
+                         wx, wy, wz, n_waypoints, threshold, tolerance,
+                         max_iterations, capacity, waypoint, segment, lati,
+                         loni, spi, s1i, iterations, ok);
+}
+
+namespace {
+
+/** An inverse problem and its solution, as remembered by a cache slot */
+struct cached_inverse {
+  bool valid = false;
+  geodesic_solver solver;
+  double lat1, lon1, lat2, lon2;
+  bool ok;
+  double s12, azi1, azi2, a12;
+  geodesic_path path;
+};
+
+/** A direct problem and its solution, as remembered by a cache slot */
+struct cached_direct {
+  bool valid = false;
+  double lat1, lon1, azi1, s12;
+  bool ok;
+  double lat2, lon2, a12;
+};
+
+/** The splitmix64 finalizer, which scrambles every bit of its input */
+uint64_t mix(uint64_t h) noexcept {
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+  return h ^ (h >> 31);
+}
+
+uint64_t hash_point(double lat, double lon) noexcept {
+  return mix(bits_of(lat) ^ mix(bits_of(lon)));
+}
+
+/** The azimuth opposite `azi`, in (-180, 180] like GeographicLib's */
+double reverse_azimuth(double azi) noexcept {
+  return azi > 0 ? azi - 180 : azi + 180;
+}
+
+}  // namespace
+
+/**
+ * A cache's slots, each guarded by one of a fixed set of locks
+ *
+ * Both tables are two-way set associative: a problem may be remembered in
+ * either slot of the pair its hash picks, and a new solution takes the first
+ * slot, pushing out the older solution from the second.  An inverse
+ * problem's hash depends on its points symmetrically, which puts it in the
+ * same pair as its reverse.  Solving happens outside the locks.
+ */
+struct geodesic_cache {
+  static constexpr size_t n_locks = 64;
+
+  const geo_context* ctx = nullptr;
+  /** Picks the first slot of a pair out of a hash */
+  size_t mask = 0;
+  std::unique_ptr<cached_inverse[]> inverse;
+  std::unique_ptr<cached_direct[]> direct;
+  std::mutex locks[n_locks];
+  std::atomic<uint64_t> inverse_hits{0};
+  std::atomic<uint64_t> inverse_reversed_hits{0};
+  std::atomic<uint64_t> inverse_misses{0};
+  std::atomic<uint64_t> direct_hits{0};
+  std::atomic<uint64_t> direct_misses{0};
+};
+
+EXTERN geodesic_cache* geo_context_geodesic_cache_new(
+    const geo_context* ctx, size_t capacity) noexcept {
+  if (capacity == 0 || capacity > (std::numeric_limits<size_t>::max() >> 2)) {
+    return nullptr;
+  }
+  size_t n_slots = 2;
+  while (n_slots < capacity) {
+    n_slots <<= 1;
+  }
+  try {
+    auto cache = new geodesic_cache;
+    cache->ctx = ctx;
+    cache->mask = n_slots - 2;
+    cache->inverse.reset(new cached_inverse[n_slots]);
+    cache->direct.reset(new cached_direct[n_slots]);
+    return cache;
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+EXTERN void geodesic_cache_free(geodesic_cache* cache) noexcept {
+  delete cache;
+}
+
+EXTERN bool geodesic_cache_inverse(geodesic_cache* cache,
+                                   geodesic_solver solver, double lat1,
+                                   double lon1, double lat2, double lon2,
+                                   double* s12, double* azi1, double* azi2,
+                                   double* a12, geodesic_path* path) noexcept {
+  const probe_timer timer(SHIM_STATS_CACHE_INVERSE);
+  constexpr auto relaxed = std::memory_order_relaxed;
+  if (!all_finite({lat1, lon1, lat2, lon2})) {
+    cache->inverse_misses.fetch_add(1, relaxed);
+    return geo_context_inverse_with_solver(cache->ctx, solver, lat1, lon1,
+                                           lat2, lon2, s12, azi1, azi2, a12,
+                                           path);
+  }
+
+  const size_t slot =
+      mix(hash_point(lat1, lon1) + hash_point(lat2, lon2) + solver) &
+      cache->mask;
+  std::mutex& lock = cache->locks[(slot >> 1) % geodesic_cache::n_locks];
+  cached_inverse* entries = &cache->inverse[slot];
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int way = 0; way < 2; ++way) {
+      const cached_inverse& entry = entries[way];
+      if (!entry.valid || entry.solver != solver) {
+        continue;
+      }
+      if (same(entry.lat1, lat1) && same(entry.lon1, lon1) &&
+          same(entry.lat2, lat2) && same(entry.lon2, lon2)) {
+        *s12 = entry.s12;
+        *azi1 = entry.azi1;
+        *azi2 = entry.azi2;
+        *a12 = entry.a12;
+        *path = entry.path;
+        cache->inverse_hits.fetch_add(1, relaxed);
+        return entry.ok;
+      }
+      if (same(entry.lat1, lat2) && same(entry.lon1, lon2) &&
+          same(entry.lat2, lat1) && same(entry.lon2, lon1)) {
+        *s12 = entry.s12;
+        *azi1 = reverse_azimuth(entry.azi2);
+        *azi2 = reverse_azimuth(entry.azi1);
+        *a12 = entry.a12;
+        *path = entry.path;
+        cache->inverse_reversed_hits.fetch_add(1, relaxed);
+        return entry.ok;
+      }
+    }
+  }
+
+  cached_inverse solved;
+  solved.valid = true;
+  solved.solver = solver;
+  solved.lat1 = lat1;
+  solved.lon1 = lon1;
+  solved.lat2 = lat2;
+  solved.lon2 = lon2;
+  solved.ok = geo_context_inverse_with_solver(
+      cache->ctx, solver, lat1, lon1, lat2, lon2, &solved.s12, &solved.azi1,
+      &solved.azi2, &solved.a12, &solved.path);
+  *s12 = solved.s12;
+  *azi1 = solved.azi1;
+  *azi2 = solved.azi2;
+  *a12 = solved.a12;
+  *path = solved.path;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    entries[1] = entries[0];
+    entries[0] = solved;
+  }
+  cache->inverse_misses.fetch_add(1, relaxed);
+  return solved.ok;
+}
+
+EXTERN bool geodesic_cache_direct(geodesic_cache* cache, double lat1,
+                                  double lon1, double azi1, double s12,
+                                  double* lat2, double* lon2,
+                                  double* a12) noexcept {
+  const probe_timer timer(SHIM_STATS_CACHE_DIRECT);
+  constexpr auto relaxed = std::memory_order_relaxed;
+  if (!all_finite({lat1, lon1, azi1, s12})) {
+    cache->direct_misses.fetch_add(1, relaxed);
+    return geo_context_direct(cache->ctx, lat1, lon1, azi1, s12, lat2, lon2,
+                              a12);
+  }
+
+  const size_t slot =
+      mix(hash_point(lat1, lon1) ^ mix(bits_of(azi1) ^ mix(bits_of(s12)))) &
+      cache->mask;
+  std::mutex& lock = cache->locks[(slot >> 1) % geodesic_cache::n_locks];
+  cached_direct* entries = &cache->direct[slot];
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int way = 0; way < 2; ++way) {
+      const cached_direct& entry = entries[way];
+      if (entry.valid && same(entry.lat1, lat1) && same(entry.lon1, lon1) &&
+          same(entry.azi1, azi1) && same(entry.s12, s12)) {
+        *lat2 = entry.lat2;
+        *lon2 = entry.lon2;
+        *a12 = entry.a12;
+        cache->direct_hits.fetch_add(1, relaxed);
+        return entry.ok;
+      }
+    }
+  }
+
+  cached_direct solved;
+  solved.valid = true;
+  solved.lat1 = lat1;
+  solved.lon1 = lon1;
+  solved.azi1 = azi1;
+  solved.s12 = s12;
+  solved.ok = geo_context_direct(cache->ctx, lat1, lon1, azi1, s12,
+                                 &solved.lat2, &solved.lon2, &solved.a12);
+  *lat2 = solved.lat2;
+  *lon2 = solved.lon2;
+  *a12 = solved.a12;
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    entries[1] = entries[0];
+    entries[0] = solved;
+  }
+  cache->direct_misses.fetch_add(1, relaxed);
+  return solved.ok;
+}
+
+EXTERN void geodesic_cache_get_stats(const geodesic_cache* cache,
+                                     geodesic_cache_stats* stats) noexcept {
+  constexpr auto relaxed = std::memory_order_relaxed;
+  stats->inverse_hits = cache->inverse_hits.load(relaxed);
+  stats->inverse_reversed_hits = cache->inverse_reversed_hits.load(relaxed);
+  stats->inverse_misses = cache->inverse_misses.load(relaxed);
+  stats->direct_hits = cache->direct_hits.load(relaxed);
+  stats->direct_misses = cache->direct_misses.load(relaxed);
+}
+
+/**
+ * A route's points and segments, stored column by column in one block
+ *
+ * Every column lives in a single arena allocation, in the order of
+ * `route_view`'s fields, so that loading a route is one allocation and each
+ * kernel streams through contiguous arrays.  The segment index, and the
+ * single precision chords if the store filters with them, are built over the
+ * stored coordinates once loading is finished.
+ */
+struct route_store {
+  const geo_context* ctx = nullptr;
+  geodesic_solver solver = GEODESIC_SERIES;
+  prefilter_precision precision = PREFILTER_DOUBLE;
+  geodesic_cache* cache = nullptr;
+  size_t n_points = 0;
+  size_t n_segments = 0;
+  std::unique_ptr<double[]> arena;
+  std::unique_ptr<bool[]> flags;
+  std::unique_ptr<geodesic_path[]> path;
+  double *lat, *lon, *x, *y, *z, *cumulative;
+  double *azi1, *s12, *depth;
+  bool *point_ok, *segment_ok;
+  size_t n_failed_points = 0;
+  size_t n_failed_segments = 0;
+  route_index* index = nullptr;
+  std::unique_ptr<float[]> single_arena;
+  single_chords single{};
+
+  ~route_store() { route_index_free(index); }
+
+  /**
+   * Fills the single precision chords from the stored coordinates and depths
+   *
+   * The origin is the center of the finite points' bounding box.  Only called
+   * for stores filtering in single precision.
+   */
+  void build_single_chords() noexcept;
+
+  /**
+   * Sets point `i`'s single precision coordinates relative to the origin,
+   * growing the extent to cover it
+   */
+  void set_single_point(size_t i) noexcept;
+
+  /** Sets segment `s`'s single precision depth, rounded up to stay a bound */
+  void set_single_depth(size_t s) noexcept;
+};
+
+void route_store::build_single_chords() noexcept {
+  Box bounds = Box::empty();
+  for (size_t i = 0; i < n_points; ++i) {
+    if (point_ok[i]) {
+      bounds.extend(Box{{x[i], y[i], z[i]}, {x[i], y[i], z[i]}});
+    }
+  }
+  for (int axis = 0; axis < 3; ++axis) {
+    single.origin[axis] =
+        bounds.lo[axis] <= bounds.hi[axis] ? bounds.center(axis) : 0.0;
+  }
+
+  single.extent = 0.0;
+  for (size_t i = 0; i < n_points; ++i) {
+    set_single_point(i);
+  }
+  for (size_t s = 0; s < n_segments; ++s) {
+    set_single_depth(s);
+  }
+  single.x = single_arena.get();
+  single.y = single.x + n_points;
+  single.z = single.y + n_points;
+  single.depth = single.z + n_points;
+}
+
+void route_store::set_single_point(size_t i) noexcept {
+  float* fx = single_arena.get();
+  const double dx = x[i] - single.origin[0], dy = y[i] - single.origin[1],
+               dz = z[i] - single.origin[2];
+  fx[i] = static_cast<float>(dx);
+  fx[n_points + i] = static_cast<float>(dy);
+  fx[2 * n_points + i] = static_cast<float>(dz);
+  if (point_ok[i]) {
+    single.extent =
+        std::max(single.extent, std::sqrt(dx * dx + dy * dy + dz * dz));
+  }
+}
+
+void route_store::set_single_depth(size_t s) noexcept {
+  constexpr float inf = std::numeric_limits<float>::infinity();
+  float* fdepth = single_arena.get() + 3 * n_points;
+  const float d = static_cast<float>(depth[s]);
+  fdepth[s] = d < depth[s] ? std::nextafter(d, inf) : d;
+}
+
+EXTERN route_store* geo_context_route_store_new(const geo_context* ctx,
+                                                geodesic_solver solver,
+                                                prefilter_precision precision,
+                                                geodesic_cache* cache,
+                                                size_t n_points) noexcept {
   try {
-    static auto geocentric = Geocentric::WGS84();
-    geocentric.Forward(lat, lon, h, *x, *y, *z);
+    auto store = new route_store;
+    store->ctx = ctx;
+    store->solver = solver;
+    store->precision = precision;
+    store->cache = cache;
+    store->n_points = n_points;
+    store->n_segments = n_points < 2 ? 0 : n_points - 1;
+    const size_t n_segments = store->n_segments;
+
+    // Columns of length zero still point into the arena, never at null.
+    store->arena.reset(new double[6 * n_points + 3 * n_segments + 1]);
+    store->flags.reset(new bool[n_points + n_segments + 1]);
+    store->path.reset(new geodesic_path[n_segments + 1]);
+    double* next = store->arena.get();
+    for (double** column : {&store->lat, &store->lon, &store->x, &store->y,
+                            &store->z, &store->cumulative}) {
+      *column = next;
+      next += n_points;
+    }
+    for (double** column : {&store->azi1, &store->s12, &store->depth}) {
+      *column = next;
+      next += n_segments;
+    }
+    store->point_ok = store->flags.get();
+    store->segment_ok = store->flags.get() + n_points;
+    if (precision == PREFILTER_SINGLE) {
+      store->single_arena.reset(new float[3 * n_points + n_segments + 1]);
+    }
+    return store;
   } catch (...) {
+    return nullptr;
+  }
+}
+
+EXTERN void route_store_free(route_store* store) noexcept { delete store; }
+
+EXTERN size_t route_store_load(route_store* store, const double* lat,
+                               const double* lon, size_t start,
+                               size_t count) noexcept {
+  const probe_timer timer(SHIM_STATS_ROUTE_STORE_LOAD);
+  std::copy(lat + start, lat + start + count, store->lat + start);
+  std::copy(lon + start, lon + start + count, store->lon + start);
+
+  // Points are converted a block at a time, and the block's segments are
+  // solved straight after, from the sines and cosines of latitude its
+  // conversion left behind.  Only the point ending each block's last segment
+  // has them computed a second time, since it belongs to the next block.
+  double sphi[geocentric_block_size + 1], cphi[geocentric_block_size + 1];
+  size_t num_ok = 0, num_segments = 0;
+  for (size_t first = start; first < start + count;
+       first += geocentric_block_size) {
+    const size_t m = std::min(geocentric_block_size, start + count - first);
+    num_ok += geocentric_vertices(store->ctx, lat + first, lon + first, m,
+                                  store->x + first, store->y + first,
+                                  store->z + first, sphi, cphi,
+                                  store->point_ok + first);
+
+    // Segments read their points from the caller's arrays rather than the
+    // store, since the point ending a range's last segment belongs to the
+    // next.
+    const size_t end = std::min(first + m, store->n_segments);
+    if (first + m < store->n_points) {
+      sincosd_n(lat + first + m, 1, sphi + m, cphi + m);
+    }
+    for (size_t s = first; s < end; ++s) {
+      const size_t k = s - first;
+      double azi2, a12;
+      store->segment_ok[s] =
+          store->cache != nullptr
+              ? geodesic_cache_inverse(store->cache, store->solver, lat[s],
+                                       lon[s], lat[s + 1], lon[s + 1],
+                                       &store->s12[s], &store->azi1[s], &azi2,
+                                       &a12, &store->path[s])
+              : inverse_with_solver(store->ctx, store->solver, lat[s], lon[s],
+                                    sphi[k], cphi[k], lat[s + 1], lon[s + 1],
+                                    sphi[k + 1], cphi[k + 1], &store->s12[s],
+                                    &store->azi1[s], &azi2, &a12,
+                                    &store->path[s]);
+      num_ok += store->segment_ok[s];
+      ++num_segments;
+    }
+  }
+  return count + num_segments - num_ok;
+}
+
+EXTERN bool route_store_finish(route_store* store) noexcept {
+  const probe_timer timer(SHIM_STATS_ROUTE_STORE_FINISH);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  store->n_failed_points = 0;
+  for (size_t i = 0; i < store->n_points; ++i) {
+    store->n_failed_points += !store->point_ok[i];
+  }
+  store->n_failed_segments = 0;
+  if (store->n_points > 0) {
+    store->cumulative[0] = 0.0;
+  }
+  for (size_t s = 0; s < store->n_segments; ++s) {
+    store->n_failed_segments += !store->segment_ok[s];
+    store->cumulative[s + 1] =
+        store->cumulative[s] + (store->segment_ok[s] ? store->s12[s] : nan);
+  }
+  geo_context_chord_depths(store->ctx, store->x, store->y, store->z,
+                           store->n_points, store->depth);
+  if (store->precision == PREFILTER_SINGLE) {
+    store->build_single_chords();
+  }
+
+  // The index can't place points or segments that failed to convert, so
+  // routes with any fall back to scanning every segment.
+  const bool all_ok =
+      store->n_failed_points == 0 && store->n_failed_segments == 0;
+  route_index_free(store->index);
+  store->index = all_ok ? geo_context_route_index_new(store->ctx, store->x,
+                                                      store->y, store->z,
+                                                      store->n_points)
+                        : nullptr;
+  // The cache only has to outlive loading, so edits solve without it.
+  store->cache = nullptr;
+  return all_ok;
+}
+
+EXTERN bool route_store_move_point(route_store* store, size_t i, double lat,
+                                   double lon) noexcept {
+  const probe_timer timer(SHIM_STATS_ROUTE_STORE_MOVE_POINT);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  if (i >= store->n_points) {
     return false;
   }
-  return true;
+  store->lat[i] = lat;
+  store->lon[i] = lon;
+  store->n_failed_points -= !store->point_ok[i];
+
+  // The moved point's segments run from point `lo` to point `hi`, and are
+  // solved from the sines and cosines of latitude its conversion leaves
+  // behind, and its neighbors', just as loading solves them.
+  const size_t lo = i == 0 ? 0 : i - 1;
+  const size_t hi = std::min(i + 1, store->n_segments);
+  double sphi[3], cphi[3];
+  bool ok = geocentric_vertices(store->ctx, store->lat + i, store->lon + i, 1,
+                                store->x + i, store->y + i, store->z + i,
+                                sphi + (i - lo), cphi + (i - lo),
+                                store->point_ok + i) == 1;
+  for (size_t k = lo; k <= hi; ++k) {
+    if (k != i) {
+      sincosd_n(store->lat + k, 1, sphi + (k - lo), cphi + (k - lo));
+    }
+  }
+  for (size_t s = lo; s < hi; ++s) {
+    store->n_failed_segments -= !store->segment_ok[s];
+  }
+  for (size_t s = lo; s < hi; ++s) {
+    const size_t k = s - lo;
+    double azi2, a12;
+    store->segment_ok[s] = inverse_with_solver(
+        store->ctx, store->solver, store->lat[s], store->lon[s], sphi[k],
+        cphi[k], store->lat[s + 1], store->lon[s + 1], sphi[k + 1],
+        cphi[k + 1], &store->s12[s], &store->azi1[s], &azi2, &a12,
+        &store->path[s]);
+    ok &= store->segment_ok[s];
+    store->n_failed_segments += !store->segment_ok[s];
+  }
+  store->n_failed_points += !store->point_ok[i];
+
+  // Summed in the same order as when finishing, so that every distance
+  // after the edit is what a fresh load would give.
+  for (size_t s = lo; s < store->n_segments; ++s) {
+    store->cumulative[s + 1] =
+        store->cumulative[s] + (store->segment_ok[s] ? store->s12[s] : nan);
+  }
+  geo_context_chord_depths(store->ctx, store->x + lo, store->y + lo,
+                           store->z + lo, hi - lo + 1, store->depth + lo);
+  if (store->precision == PREFILTER_SINGLE) {
+    store->set_single_point(i);
+    for (size_t s = lo; s < hi; ++s) {
+      store->set_single_depth(s);
+    }
+  }
+
+  // As when finishing, a route with a point or segment that failed to
+  // convert is scanned instead of indexed, until moves make them convert.
+  const bool all_ok =
+      store->n_failed_points == 0 && store->n_failed_segments == 0;
+  if (store->index == nullptr) {
+    if (all_ok) {
+      store->index = geo_context_route_index_new(
+          store->ctx, store->x, store->y, store->z, store->n_points);
+    }
+  } else {
+    bool refit = all_ok;
+    try {
+      for (size_t s = lo; refit && s < hi; ++s) {
+        store->index->refit(s, segment_box(store->ctx->shape.a,
+                                           store->ctx->shape.b, store->x,
+                                           store->y, store->z, s));
+      }
+    } catch (...) {
+      refit = false;
+    }
+    if (!refit) {
+      route_index_free(store->index);
+      store->index = nullptr;
+    }
+  }
+  return ok;
+}
+
+EXTERN bool route_store_indexed(const route_store* store) noexcept {
+  return store->index != nullptr;
+}
+
+EXTERN void route_store_view(const route_store* store,
+                             route_view* view) noexcept {
+  view->n_points = store->n_points;
+  view->lat = store->lat;
+  view->lon = store->lon;
+  view->x = store->x;
+  view->y = store->y;
+  view->z = store->z;
+  view->cumulative = store->cumulative;
+  view->azi1 = store->azi1;
+  view->s12 = store->s12;
+  view->depth = store->depth;
+  view->point_ok = store->point_ok;
+  view->segment_ok = store->segment_ok;
+  view->path = store->path.get();
+}
+
+EXTERN size_t route_store_match_waypoints(
+    const route_store* store, const double* wlat, const double* wlon,
+    const double* wx, const double* wy, const double* wz, size_t n_waypoints,
+    double threshold, double tolerance, unsigned max_iterations,
+    size_t capacity, size_t* waypoint, size_t* segment, double* lati,
+    double* loni, double* spi, double* s1i, unsigned* iterations,
+    bool* ok) noexcept {
+  if (store->precision == PREFILTER_SINGLE) {
+    return match_waypoints(store->ctx, store->index, store->lat, store->lon,
+                           store->azi1, store->s12, store->single,
+                           store->n_points, wlat, wlon, wx, wy, wz,
+                           n_waypoints, threshold, tolerance, max_iterations,
+                           capacity, waypoint, segment, lati, loni, spi, s1i,
+                           iterations, ok);
+  }
+  return geo_context_match_waypoints(
+      store->ctx, store->index, store->lat, store->lon, store->x, store->y,
+      store->z, store->azi1, store->s12, store->depth, store->n_points, wlat,
+      wlon, wx, wy, wz, n_waypoints, threshold, tolerance, max_iterations,
+      capacity, waypoint, segment, lati, loni, spi, s1i, iterations, ok);
+}
+
+EXTERN size_t route_store_match_segments(
+    const route_store* store, size_t first_segment, size_t n_segments,
+    const double* wlat, const double* wlon, const double* wx,
+    const double* wy, const double* wz, size_t n_waypoints, double threshold,
+    double tolerance, unsigned max_iterations, size_t capacity,
+    size_t* waypoint, size_t* segment, double* lati, double* loni, double* spi,
+    double* s1i, unsigned* iterations, bool* ok) noexcept {
+  const size_t first = std::min(first_segment, store->n_segments);
+  const size_t count = std::min(n_segments, store->n_segments - first);
+  if (first == 0 && count == store->n_segments) {
+    return route_store_match_waypoints(
+        store, wlat, wlon, wx, wy, wz, n_waypoints, threshold, tolerance,
+        max_iterations, capacity, waypoint, segment, lati, loni, spi, s1i,
+        iterations, ok);
+  }
+  if (count == 0) {
+    return 0;
+  }
+
+  // The range's segments are a route of their own, starting at the first
+  // one's point.
+  auto match = [&](const auto& chords) {
+    return match_waypoints(
+        store->ctx, nullptr, store->lat + first, store->lon + first,
+        store->azi1 + first, store->s12 + first, chords, count + 1, wlat,
+        wlon, wx, wy, wz, n_waypoints, threshold, tolerance, max_iterations,
+        capacity, waypoint, segment, lati, loni, spi, s1i, iterations, ok);
+  };
+  size_t num_matches;
+  if (store->precision == PREFILTER_SINGLE) {
+    single_chords chords = store->single;
+    chords.x += first;
+    chords.y += first;
+    chords.z += first;
+    chords.depth += first;
+    num_matches = match(chords);
+  } else {
+    num_matches = match(double_chords{store->x + first, store->y + first,
+                                      store->z + first, store->depth + first});
+  }
+  for (size_t k = 0; k < std::min(num_matches, capacity); ++k) {
+    segment[k] += first;
+  }
+  return num_matches;
+}
+
+/**
+ * The state a streaming segmenter carries between chunks
+ *
+ * Only the route's trailing point is kept, since its record can't be emitted
+ * until the segment leaving it is known.
+ */
+struct route_segmenter {
+  const geo_context* ctx = nullptr;
+  geodesic_solver solver = GEODESIC_SERIES;
+  bool pending = false;
+  double lat, lon, x, y, z, sphi, cphi;
+  bool point_ok;
+  double cumulative = 0.0;
+};
+
+EXTERN route_segmenter* geo_context_route_segmenter_new(
+    const geo_context* ctx, geodesic_solver solver) noexcept {
+  try {
+    auto segmenter = new route_segmenter;
+    segmenter->ctx = ctx;
+    segmenter->solver = solver;
+    return segmenter;
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+EXTERN void route_segmenter_free(route_segmenter* segmenter) noexcept {
+  delete segmenter;
+}
+
+EXTERN size_t route_segmenter_push(route_segmenter* segmenter,
+                                   const double* lat, const double* lon,
+                                   size_t n, double* x, double* y, double* z,
+                                   double* cumulative, double* azi1,
+                                   double* s12, geodesic_path* path,
+                                   bool* point_ok, bool* segment_ok) noexcept {
+  const probe_timer timer(SHIM_STATS_SEGMENTER_PUSH);
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+
+  // Points are converted a block at a time, and each one's conversion leaves
+  // the sines and cosines of its latitude for solving the segment ending at
+  // it.  A pending point from the last chunk takes the first record, shifting
+  // the new points' records along by one.
+  const size_t first = segmenter->pending ? 1 : 0;
+  double bx[geocentric_block_size], by[geocentric_block_size],
+      bz[geocentric_block_size];
+  double sphi[geocentric_block_size], cphi[geocentric_block_size];
+  bool ok[geocentric_block_size];
+  for (size_t start = 0; start < n; start += geocentric_block_size) {
+    const size_t m = std::min(geocentric_block_size, n - start);
+    geocentric_vertices(segmenter->ctx, lat + start, lon + start, m, bx, by,
+                        bz, sphi, cphi, ok);
+
+    for (size_t k = 0; k < m; ++k) {
+      const size_t i = start + k;
+      if (segmenter->pending) {
+        // The segment leaving the pending point's record, r, ends at new
+        // point i.
+        const size_t r = i + first - 1;
+        if (i == 0) {
+          x[0] = segmenter->x;
+          y[0] = segmenter->y;
+          z[0] = segmenter->z;
+          point_ok[0] = segmenter->point_ok;
+        }
+        double azi2, a12;
+        segment_ok[r] = inverse_with_solver(
+            segmenter->ctx, segmenter->solver, segmenter->lat, segmenter->lon,
+            segmenter->sphi, segmenter->cphi, lat[i], lon[i], sphi[k],
+            cphi[k], &s12[r], &azi1[r], &azi2, &a12, &path[r]);
+        cumulative[r] = segmenter->cumulative;
+        segmenter->cumulative += segment_ok[r] ? s12[r] : nan;
+      }
+
+      if (i + 1 < n) {
+        // The next iteration solves this record's segment.  The chunk's last
+        // point is instead kept until the next push or flush.
+        const size_t r = i + first;
+        x[r] = bx[k];
+        y[r] = by[k];
+        z[r] = bz[k];
+        point_ok[r] = ok[k];
+      } else {
+        segmenter->x = bx[k];
+        segmenter->y = by[k];
+        segmenter->z = bz[k];
+        segmenter->point_ok = ok[k];
+      }
+      segmenter->pending = true;
+      segmenter->lat = lat[i];
+      segmenter->lon = lon[i];
+      segmenter->sphi = sphi[k];
+      segmenter->cphi = cphi[k];
+    }
+  }
+  return n == 0 ? 0 : n - 1 + first;
+}
+
+EXTERN size_t route_segmenter_flush(route_segmenter* segmenter, double* x,
+                                    double* y, double* z, double* cumulative,
+                                    double* azi1, double* s12, bool* point_ok,
+                                    bool* segment_ok) noexcept {
+  if (!segmenter->pending) {
+    return 0;
+  }
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  *x = segmenter->x;
+  *y = segmenter->y;
+  *z = segmenter->z;
+  *point_ok = segmenter->point_ok;
+  *cumulative = segmenter->cumulative;
+  *azi1 = *s12 = nan;
+  *segment_ok = false;
+
+  segmenter->pending = false;
+  segmenter->cumulative = 0.0;
+  return 1;
+}
+
+EXTERN bool geo_context_geocentric_forward(const geo_context* ctx, double lat,
+                                           double lon, double h, double* x,
+                                           double* y, double* z) noexcept {
+  return solve(all_finite({lat, lon, h}), [&] {
+    ctx->geocentric.Forward(lat, lon, h, *x, *y, *z);
+  });
+}
+
+EXTERN size_t geo_context_geocentric_forward_batch(const geo_context* ctx,
+                                                   const double* lat,
+                                                   const double* lon, size_t n,
+                                                   double* x, double* y,
+                                                   double* z,
+                                                   bool* ok) noexcept {
+  const probe_timer timer(SHIM_STATS_GEOCENTRIC_BATCH);
+
+  double sphi[geocentric_block_size], cphi[geocentric_block_size];
+  size_t num_ok = 0;
+  for (size_t start = 0; start < n; start += geocentric_block_size) {
+    const size_t m = std::min(geocentric_block_size, n - start);
+    num_ok += geocentric_vertices(ctx, lat + start, lon + start, m, x + start,
+                                  y + start, z + start, sphi, cphi,
+                                  ok + start);
+  }
+  return num_ok;
+}
+
+EXTERN bool geodesic_inverse_with_azimuth(double lat1, double lon1, double lat2,
+                                          double lon2, double* s12,
+                                          double* azi1, double* azi2,
+                                          double* a12) noexcept {
+  return geo_context_inverse(&wgs84, lat1, lon1, lat2, lon2, s12, azi1, azi2,
+                             a12);
+}
+
+EXTERN bool geodesic_direct(double lat1, double lon1, double azi1, double s12,
+                            double* lat2, double* lon2, double* a12) noexcept {
+  return geo_context_direct(&wgs84, lat1, lon1, azi1, s12, lat2, lon2, a12);
+}
+
+EXTERN size_t geodesic_polyline_inverse(const double* latlon, size_t n,
+                                        double* s12, double* azi1,
+                                        double* azi2, double* a12,
+                                        double* cumulative, bool* ok) noexcept {
+  return geo_context_polyline_inverse(&wgs84, latlon, n, s12, azi1, azi2, a12,
+                                      cumulative, ok);
+}
+
+EXTERN bool gnomonic_forward(double lat0, double lon0, double lat, double lon,
+                             double* x, double* y) noexcept {
+  return geo_context_gnomonic_forward(&wgs84, lat0, lon0, lat, lon, x, y);
+}
+
+EXTERN bool gnomonic_reverse(double lat0, double lon0, double x, double y,
+                             double* lat, double* lon) noexcept {
+  return geo_context_gnomonic_reverse(&wgs84, lat0, lon0, x, y, lat, lon);
+}
+
+EXTERN bool geodesic_intercept(double lat1, double lon1, double lat2,
+                               double lon2, double azi1, double s12,
+                               double latp, double lonp, double tolerance,
+                               unsigned max_iterations, double* lati,
+                               double* loni, double* spi, double* s1i,
+                               unsigned* iterations) noexcept {
+  return geo_context_intercept(&wgs84, lat1, lon1, lat2, lon2, azi1, s12, latp,
+                               lonp, tolerance, max_iterations, lati, loni,
+                               spi, s1i, iterations);
+}
+
+EXTERN bool geocentric_forward(double lat, double lon, double h, double* x,
+                               double* y, double* z) noexcept {
+  return geo_context_geocentric_forward(&wgs84, lat, lon, h, x, y, z);
+}
+
+EXTERN size_t geocentric_forward_batch(const double* lat, const double* lon,
+                                       size_t n, double* x, double* y,
+                                       double* z, bool* ok) noexcept {
+  return geo_context_geocentric_forward_batch(&wgs84, lat, lon, n, x, y, z, ok);
+}
+
+EXTERN void shim_stats_enable(bool enabled) noexcept {
+  stats_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+EXTERN void shim_stats_snapshot(shim_stats* stats) noexcept {
+  constexpr auto relaxed = std::memory_order_relaxed;
+  std::memset(stats, 0, sizeof(*stats));
+  for (const auto& stripe : stats_counters) {
+    for (size_t p = 0; p < SHIM_STATS_N_PROBES; ++p) {
+      shim_probe_stats& probe = stats->probes[p];
+      probe.calls += stripe[p].calls.load(relaxed);
+      probe.nanoseconds += stripe[p].nanoseconds.load(relaxed);
+      for (size_t k = 0; k < SHIM_STATS_BUCKETS; ++k) {
+        probe.histogram[k] += stripe[p].histogram[k].load(relaxed);
+      }
+    }
+  }
+}
+
+EXTERN void shim_stats_reset() noexcept {
+  constexpr auto relaxed = std::memory_order_relaxed;
+  for (auto& stripe : stats_counters) {
+    for (probe_counters& counters : stripe) {
+      counters.calls.store(0, relaxed);
+      counters.nanoseconds.store(0, relaxed);
+      for (auto& bucket : counters.histogram) {
+        bucket.store(0, relaxed);
+      }
+    }
+  }
 }
 
 /**
@@ -138,3 +2473,10 @@ EXTERN const char* compiler_version() noexcept {
   return "unknown";
 #endif
 }
+
+/**
+ * Gets the name of the instruction set the batch kernels were dispatched to
+ *
+ * The string returned has static lifetime.
+ */
+EXTERN const char* shim_cpu_features() noexcept { return kernels.name; }
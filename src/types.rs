@@ -1,5 +1,5 @@
 use approx::{AbsDiffEq, RelativeEq, abs_diff_eq, relative_eq};
-use dimensioned::si::{M, Meter};
+use dimensioned::si::Meter;
 use thiserror::Error;
 
 use crate::measure::{DEG, Degree};
@@ -200,22 +200,6 @@ impl HasXyzPoint for GeoAndXyzPoint {
     }
 }
 
-/// A point on a 2D projection.
-#[derive(Clone, Copy, PartialEq, Debug)]
-pub struct XyPoint {
-    pub x: Meter<f64>,
-    pub y: Meter<f64>,
-}
-
-impl Default for XyPoint {
-    fn default() -> Self {
-        Self {
-            x: 0.0 * M,
-            y: 0.0 * M,
-        }
-    }
-}
-
 /// Instantiate a [`GeoPoint`] with a tuple-like syntax, optionally including an
 /// elevation in meters.
 #[doc(hidden)]
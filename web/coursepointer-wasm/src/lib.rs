@@ -1,7 +1,10 @@
 use std::io::Cursor;
 
 use coursepointer::course::{Course, CoursePoint, CourseSetBuilder, CourseSetOptions, Record};
-use coursepointer::internal::Kilometer;
+use coursepointer::internal::report::shim_stats_report;
+use coursepointer::internal::{
+    Kilometer, shim_stats_enable, shim_stats_reset, shim_stats_snapshot,
+};
 use coursepointer::{
     CoursePointType, DEG, FitCourseOptions, GeoPoint, Sport, convert_gpx_to_fit, read_gpx,
 };
@@ -38,9 +41,31 @@ impl From<WasmWrapperError> for JsValue {
 
 pub type Result<T> = std::result::Result<T, WasmWrapperError>;
 
+/// Whether to profile the shim's calls, which only development builds do.
+const SHIM_STATS: bool = cfg!(debug_assertions);
+
 #[wasm_bindgen(start)]
 pub fn init() {
     wasm_logger::init(wasm_logger::Config::new(log::Level::Debug));
+    shim_stats_enable(SHIM_STATS);
+}
+
+/// Logs the shim's profile since the last reset, for the worker's console.
+///
+/// The profile is only a diagnostic, so failing to produce it doesn't fail the
+/// conversion it describes.
+fn log_shim_stats() {
+    let stats = match shim_stats_snapshot() {
+        Ok(stats) => stats,
+        Err(e) => {
+            log::warn!("Unable to read shim stats: {e}");
+            return;
+        }
+    };
+    match shim_stats_report(&stats) {
+        Ok(report) => log::debug!("{report}"),
+        Err(e) => log::warn!("Unable to report shim stats: {e}"),
+    }
 }
 
 #[derive(Serialize, Copy, Clone)]
@@ -173,6 +198,12 @@ pub fn convert_gpx_to_fit_bytes(gpx_input: &[u8], options: JsValue) -> Result<Js
     let report =
         coursepointer::internal::report::conversion_report::<Kilometer<f64>>(info.clone())?;
 
+    // Each conversion's shim profile is logged on its own.
+    if SHIM_STATS {
+        log_shim_stats();
+        shim_stats_reset();
+    }
+
     let info = JsConversionInfo {
         course_name: info.course_name.unwrap_or_default(),
         total_distance_m: info.total_distance.value_unsafe,
@@ -1,9 +1,66 @@
 // @ts-expect-error: Missing module declaration
 import geographicLib from "./wasm/geographiclib.mjs";
 import init from "coursepointer-wasm";
+import coursepointerWasmUrl from "coursepointer-wasm/coursepointer_wasm_bg.wasm?url";
+
+type Instantiator = (
+  imports: WebAssembly.Imports,
+  receiveInstance: (
+    instance: WebAssembly.Instance,
+    module: WebAssembly.Module,
+  ) => void,
+) => object;
+
+/**
+ * Instantiate an Emscripten module from its factory and its compiled wasm, or
+ * with the factory's own fetch if there is none.
+ */
+async function instantiate(
+  factory: (moduleArg?: { instantiateWasm?: Instantiator }) => Promise<any>,
+  wasm: Promise<WebAssembly.Module | undefined>,
+) {
+  const module = await wasm;
+  if (module === undefined) {
+    return await factory();
+  }
+
+  let fail!: (reason: unknown) => void;
+  const failed = new Promise<never>((_, reject) => (fail = reject));
+  return await Promise.race([
+    factory({
+      instantiateWasm(imports, receiveInstance) {
+        WebAssembly.instantiate(module, imports).then(
+          (instance) => receiveInstance(instance, module),
+          fail,
+        );
+        return {};
+      },
+    }),
+    failed,
+  ]);
+}
+
+/**
+ * Load the GeographicLib module, compiling its wasm as it downloads.
+ *
+ * If the wasm couldn't be compiled that way (for example, if it wasn't served
+ * as application/wasm), the module's factory fetches it itself instead.
+ */
+async function loadGeographicLib() {
+  const wasm = WebAssembly.compileStreaming(
+    fetch(new URL("./wasm/geographiclib.wasm", import.meta.url)),
+  ).catch((e) => {
+    console.warn("Unable to compile GeographicLib while downloading:", e);
+    return undefined;
+  });
+  return await instantiate(geographicLib, wasm);
+}
 
 /**
  * Initialize the WASM modules.
+ *
+ * This runs in the worker as soon as the page loads, so both modules are
+ * downloaded and compiled while the user is still picking a file.
  */
 export async function initialize() {
   // So that I don't have to figure out how to address Vite modules from
@@ -13,12 +70,16 @@ export async function initialize() {
   // In web workers there is no window object, so we instead create a fake
   // "window" attached to the worker's global self.
 
-  const geo = await geographicLib();
+  // The Rust module's start function calls into GeographicLib, so it can
+  // only be instantiated after it, but it can be downloading in the meantime.
+  const coursepointer = fetch(coursepointerWasmUrl);
+
+  const geo = await loadGeographicLib();
   if (typeof window !== "undefined") {
     (window as any).GEO = geo;
   } else {
     (self as any).window = self;
     (self as any).GEO = geo;
   }
-  await init();
+  await init({ module_or_path: coursepointer });
 }